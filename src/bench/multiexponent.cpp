@@ -0,0 +1,53 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <secp256k1/include/GroupElement.h>
+#include <secp256k1/include/MultiExponent.h>
+#include <secp256k1/include/Scalar.h>
+
+#include <vector>
+
+// Multi-exponentiation over nPoints random points on nThreads threads, the
+// shape of the commitment sum in SigmaPlusVerifier::verify.
+static void MultiExponentScaling(benchmark::State& state, std::size_t nPoints, std::size_t nThreads)
+{
+    std::vector<secp_primitives::GroupElement> points(nPoints);
+    std::vector<secp_primitives::Scalar> exps(nPoints);
+    for (std::size_t i = 0; i < nPoints; ++i) {
+        points[i].randomize();
+        exps[i].randomize();
+    }
+
+    std::size_t nPrevThreads = secp_primitives::MultiExponent::get_thread_count();
+    secp_primitives::MultiExponent::set_thread_count(nThreads);
+    while (state.KeepRunning()) {
+        secp_primitives::MultiExponent(points, exps).get_multiple();
+    }
+    secp_primitives::MultiExponent::set_thread_count(nPrevThreads);
+}
+
+#define MULTIEXPONENT_BENCH(points, threads, iters)                            \
+    static void MultiExponent_##points##_##threads(benchmark::State& state)     \
+    {                                                                           \
+        MultiExponentScaling(state, points, threads);                           \
+    }                                                                           \
+    BENCHMARK(MultiExponent_##points##_##threads, iters)
+
+MULTIEXPONENT_BENCH(1024, 1, 60);
+MULTIEXPONENT_BENCH(1024, 2, 100);
+MULTIEXPONENT_BENCH(1024, 4, 160);
+MULTIEXPONENT_BENCH(1024, 8, 160);
+MULTIEXPONENT_BENCH(1024, 16, 160);
+MULTIEXPONENT_BENCH(4096, 1, 16);
+MULTIEXPONENT_BENCH(4096, 2, 30);
+MULTIEXPONENT_BENCH(4096, 4, 60);
+MULTIEXPONENT_BENCH(4096, 8, 100);
+MULTIEXPONENT_BENCH(4096, 16, 120);
+MULTIEXPONENT_BENCH(16384, 1, 4);
+MULTIEXPONENT_BENCH(16384, 2, 8);
+MULTIEXPONENT_BENCH(16384, 4, 16);
+MULTIEXPONENT_BENCH(16384, 8, 30);
+MULTIEXPONENT_BENCH(16384, 16, 50);
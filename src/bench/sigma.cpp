@@ -0,0 +1,232 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <crypto/sha256.h>
+#include <secp256k1/include/GroupElement.h>
+#include <secp256k1/include/MultiExponent.h>
+#include <secp256k1/include/Scalar.h>
+#include <sigma/coin.h>
+#include <sigma/coinspend.h>
+#include <sigma/params.h>
+#include <sigma/r1_proof_generator.h>
+#include <sigma/r1_proof_verifier.h>
+#include <sigma/sigmaplus_prover.h>
+#include <sigma/sigmaplus_verifier.h>
+#include <streams.h>
+#include <version.h>
+#include <zerocoin/sigma.h>
+
+#include <vector>
+
+typedef secp_primitives::Scalar Scalar;
+typedef secp_primitives::GroupElement GroupElement;
+
+namespace {
+
+// Scalar number nIndex of the stream tagged with chTag, the same on every run
+Scalar FixtureScalar(unsigned char chTag, uint32_t nIndex)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(&chTag, 1).Write((const unsigned char*)&nIndex, sizeof(nIndex)).Finalize(hash);
+    return Scalar(hash);
+}
+
+// A full coin group of COINS_PER_ID commitments. An anonymity set of size N is made of the first N of them.
+struct SigmaFixture
+{
+    std::vector<Scalar> serials;
+    std::vector<Scalar> randomness;
+    std::vector<GroupElement> commits;
+
+    SigmaFixture()
+    {
+        const sigma::Params* params = sigma::Params::get_default();
+        for (uint32_t i = 0; i < COINS_PER_ID; ++i) {
+            serials.push_back(FixtureScalar('s', i));
+            randomness.push_back(FixtureScalar('r', i));
+            commits.push_back(sigma::SigmaPrimitives<Scalar, GroupElement>::commit(
+                params->get_g(), serials.back(), params->get_h()[0], randomness.back()));
+        }
+        GroupElement::normalize_all(commits);
+    }
+
+    // Commitments of the first nSetSize coins as the sigma proof of spending coin nIndex sees them, with
+    // its serial number taken out
+    std::vector<GroupElement> SpendCommits(std::size_t nSetSize, std::size_t nIndex) const
+    {
+        const sigma::Params* params = sigma::Params::get_default();
+        GroupElement gs = (params->get_g() * serials[nIndex]).inverse();
+        std::vector<GroupElement> result;
+        result.reserve(nSetSize);
+        for (std::size_t i = 0; i < nSetSize; ++i)
+            result.push_back(commits[i] + gs);
+        GroupElement::normalize_all(result);
+        return result;
+    }
+};
+
+const SigmaFixture& GetSigmaFixture()
+{
+    static const SigmaFixture fixture;
+    return fixture;
+}
+
+} // namespace
+
+static void SigmaProve(benchmark::State& state, std::size_t nSetSize)
+{
+    const sigma::Params* params = sigma::Params::get_default();
+    const SigmaFixture& fixture = GetSigmaFixture();
+    std::size_t nIndex = nSetSize / 2;
+    std::vector<GroupElement> commits = fixture.SpendCommits(nSetSize, nIndex);
+
+    sigma::SigmaPlusProver<Scalar, GroupElement> prover(params->get_g(), params->get_h(), params->get_n(), params->get_m());
+    while (state.KeepRunning()) {
+        sigma::SigmaPlusProof<Scalar, GroupElement> proof(params);
+        prover.proof(commits, nIndex, fixture.randomness[nIndex], true, proof);
+    }
+}
+
+static void SigmaVerify(benchmark::State& state, std::size_t nSetSize)
+{
+    const sigma::Params* params = sigma::Params::get_default();
+    const SigmaFixture& fixture = GetSigmaFixture();
+    std::size_t nIndex = nSetSize / 2;
+    std::vector<GroupElement> commits = fixture.SpendCommits(nSetSize, nIndex);
+
+    sigma::SigmaPlusProver<Scalar, GroupElement> prover(params->get_g(), params->get_h(), params->get_n(), params->get_m());
+    sigma::SigmaPlusProof<Scalar, GroupElement> proof(params);
+    prover.proof(commits, nIndex, fixture.randomness[nIndex], true, proof);
+
+    sigma::SigmaPlusVerifier<Scalar, GroupElement> verifier(params->get_g(), params->get_h(), params->get_n(), params->get_m());
+    assert(verifier.verify(commits, proof, true));
+    while (state.KeepRunning()) {
+        verifier.verify(commits, proof, true);
+    }
+}
+
+// Multi-exponentiation of the anonymity set by the f_i exponents, the largest part of a verify
+static void SigmaMultiExponent(benchmark::State& state, std::size_t nSetSize)
+{
+    const SigmaFixture& fixture = GetSigmaFixture();
+    std::vector<Scalar> exps;
+    for (std::size_t i = 0; i < nSetSize; ++i)
+        exps.push_back(FixtureScalar('f', i));
+
+    while (state.KeepRunning()) {
+        secp_primitives::MultiExponent(fixture.commits.data(), exps.data(), nSetSize).get_multiple();
+    }
+}
+
+#define SIGMA_BENCH(name, size, iters)                                        \
+    static void name##_##size(benchmark::State& state)                       \
+    {                                                                        \
+        name(state, size);                                                   \
+    }                                                                        \
+    BENCHMARK(name##_##size, iters)
+
+SIGMA_BENCH(SigmaProve, 1024, 12);
+SIGMA_BENCH(SigmaProve, 4096, 5);
+SIGMA_BENCH(SigmaProve, 15000, 2);
+SIGMA_BENCH(SigmaVerify, 1024, 50);
+SIGMA_BENCH(SigmaVerify, 4096, 18);
+SIGMA_BENCH(SigmaVerify, 15000, 6);
+SIGMA_BENCH(SigmaMultiExponent, 1024, 70);
+SIGMA_BENCH(SigmaMultiExponent, 4096, 20);
+SIGMA_BENCH(SigmaMultiExponent, 15000, 6);
+
+// The R1 proof does not depend on the anonymity set, only on the n * m layout of the parameters
+static void SigmaR1Verify(benchmark::State& state)
+{
+    const sigma::Params* params = sigma::Params::get_default();
+    int n = params->get_n(), m = params->get_m();
+
+    std::vector<Scalar> b;
+    sigma::SigmaPrimitives<Scalar, GroupElement>::convert_to_sigma(1234, n, m, b);
+    sigma::R1ProofGenerator<Scalar, GroupElement> generator(params->get_g(), params->get_h(), b, FixtureScalar('b', 0), n, m);
+    sigma::R1Proof<Scalar, GroupElement> proof;
+    generator.proof(proof);
+
+    sigma::R1ProofVerifier<Scalar, GroupElement> verifier(params->get_g(), params->get_h(), generator.get_B(), n, m);
+    assert(verifier.verify(proof));
+    while (state.KeepRunning()) {
+        verifier.verify(proof);
+    }
+}
+
+static void GroupElementAdd(benchmark::State& state)
+{
+    const SigmaFixture& fixture = GetSigmaFixture();
+    GroupElement sum;
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        sum += fixture.commits[i++ % COINS_PER_ID];
+    }
+}
+
+static void GroupElementMultiply(benchmark::State& state)
+{
+    const SigmaFixture& fixture = GetSigmaFixture();
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        fixture.commits[i % COINS_PER_ID] * fixture.randomness[i % COINS_PER_ID];
+        ++i;
+    }
+}
+
+static void GroupElementSerialize(benchmark::State& state)
+{
+    const SigmaFixture& fixture = GetSigmaFixture();
+    unsigned char buffer[GroupElement::serialize_size];
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        fixture.commits[i++ % COINS_PER_ID].serialize(buffer);
+    }
+}
+
+static void GroupElementDeserialize(benchmark::State& state)
+{
+    const SigmaFixture& fixture = GetSigmaFixture();
+    std::vector<unsigned char> serialized(1024 * GroupElement::serialize_size);
+    for (std::size_t i = 0; i < 1024; ++i)
+        fixture.commits[i].serialize(&serialized[i * GroupElement::serialize_size]);
+
+    GroupElement element;
+    std::size_t i = 0;
+    while (state.KeepRunning()) {
+        element.deserialize(&serialized[(i++ % 1024) * GroupElement::serialize_size]);
+    }
+}
+
+// Parsing of a spend from a transaction input, see ParseSigmaSpend()
+static void SigmaCoinSpendDeserialize(benchmark::State& state)
+{
+    sigma::Params* params = sigma::Params::get_default();
+    const SigmaFixture& fixture = GetSigmaFixture();
+
+    sigma::PrivateCoin coin(params, sigma::CoinDenomination::SIGMA_1);
+    std::vector<sigma::PublicCoin> anonymitySet;
+    for (std::size_t i = 0; i < 1023; ++i)
+        anonymitySet.push_back(sigma::PublicCoin(fixture.commits[i], sigma::CoinDenomination::SIGMA_1));
+    anonymitySet.push_back(coin.getPublicCoin());
+
+    sigma::SpendMetaData metaData(1, uint256(), uint256());
+    sigma::CoinSpend spend(params, coin, anonymitySet, metaData, true);
+    CDataStream serialized(SER_NETWORK, PROTOCOL_VERSION);
+    serialized << spend;
+
+    while (state.KeepRunning()) {
+        CDataStream ss(serialized.begin(), serialized.end(), SER_NETWORK, PROTOCOL_VERSION);
+        sigma::CoinSpend parsed(params, ss);
+    }
+}
+
+BENCHMARK(SigmaR1Verify, 600);
+BENCHMARK(GroupElementAdd, 1000000);
+BENCHMARK(GroupElementMultiply, 20000);
+BENCHMARK(GroupElementSerialize, 1000000);
+BENCHMARK(GroupElementDeserialize, 100000);
+BENCHMARK(SigmaCoinSpendDeserialize, 10000);
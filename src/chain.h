@@ -180,6 +180,81 @@ enum BlockStatus: uint32_t {
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
 };
 
+/** Zerocoin and Sigma data of a block. It is kept in the privacy index
+ * (blocks/privacy/) instead of CBlockIndex, see CPrivacyIndexDB.
+ */
+class CBlockPrivacyData
+{
+public:
+    //! zerocoin specific fields
+    //!
+    //! Public coin values of mints in this block, ordered by serialized value of public coin
+    //! Maps <denomination,id> to vector of public coins
+    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
+    //! Accumulator updates. Contains only changes made by mints in this block
+    //! Maps <denomination, id> to <accumulator value (CBigNum), number of such mints in this block>
+    map<pair<int,int>, pair<CBigNum,int>> accumulatorChanges;
+    //! Values of coin serials spent in this block
+    set<CBigNum> spentSerials;
+
+    map<pair<int,int>, pair<CBigNum,int>> accumulatorChangesV2;
+
+    std::map<pair<sigma::CoinDenomination, int>, vector<sigma::PublicCoin>> mintedPubCoinsV2;
+
+    unordered_set<secp_primitives::Scalar, sigma::CScalarHash> spentSerialsV2;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(mintedPubCoins);
+        READWRITE(accumulatorChanges);
+        READWRITE(spentSerials);
+        READWRITE(mintedPubCoinsV2);
+        READWRITE(accumulatorChangesV2);
+        READWRITE(spentSerialsV2);
+    }
+
+    void SetNull()
+    {
+        mintedPubCoins.clear();
+        accumulatorChanges.clear();
+        spentSerials.clear();
+
+        mintedPubCoinsV2.clear();
+        spentSerialsV2.clear();
+        accumulatorChangesV2.clear();
+    }
+
+    bool IsNull() const
+    {
+        return mintedPubCoins.empty() && accumulatorChanges.empty() && spentSerials.empty() &&
+            mintedPubCoinsV2.empty() && accumulatorChangesV2.empty() && spentSerialsV2.empty();
+    }
+};
+
+/** Cached witness of a Zerocoin coin, the accumulator of the other coins of its group, kept in the privacy
+ * index. It is keyed by <denomination, id> and <mint height, public coin>, see CZerocoinState::GetWitnessForSpend().
+ */
+class CZerocoinWitnessRecord
+{
+public:
+    //! Witness with every coin of the group minted up to the block of the height, with the hash of that block
+    std::map<int, std::pair<uint256, CBigNum>> checkpoints;
+    //! Block up to which the newest checkpoint has every coin of the group
+    uint256 hashTip;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(checkpoints);
+        READWRITE(hashTip);
+    }
+};
+
+typedef std::pair<std::pair<int, int>, std::pair<int, CBigNum>> CZerocoinWitnessKey;
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -243,23 +318,6 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax;
 
-    //! zerocoin specific fields
-    //!
-    //! Public coin values of mints in this block, ordered by serialized value of public coin
-    //! Maps <denomination,id> to vector of public coins
-    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
-    //! Accumulator updates. Contains only changes made by mints in this block
-    //! Maps <denomination, id> to <accumulator value (CBigNum), number of such mints in this block>
-    map<pair<int,int>, pair<CBigNum,int>> accumulatorChanges;
-    //! Values of coin serials spent in this block
-    set<CBigNum> spentSerials;
-
-    map<pair<int,int>, pair<CBigNum,int>> accumulatorChangesV2;
-
-    std::map<pair<sigma::CoinDenomination, int>, vector<sigma::PublicCoin>> mintedPubCoinsV2;
-
-    unordered_set<secp_primitives::Scalar, sigma::CScalarHash> spentSerialsV2;
-
     void SetNull()
     {
         phashBlock = nullptr;
@@ -286,15 +344,6 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
-
-        //Zerocoin params
-        mintedPubCoins.clear();
-        accumulatorChanges.clear();
-        spentSerials.clear();
-
-        mintedPubCoinsV2.clear();
-        spentSerialsV2.clear();
-        accumulatorChangesV2.clear();
     }
 
     CBlockIndex()
@@ -463,6 +512,9 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hashPrev;
 
+    //! Privacy data of records written before it moved to the privacy index, empty in newer ones
+    CBlockPrivacyData privacyData;
+
     CDiskBlockIndex() {
         hashPrev = uint256();
     }
@@ -498,9 +550,9 @@ public:
         READWRITE(nNonce);
 
         //Zerocoin params
-        READWRITE(mintedPubCoins);
-        READWRITE(accumulatorChanges);
-        READWRITE(spentSerials);
+        READWRITE(privacyData.mintedPubCoins);
+        READWRITE(privacyData.accumulatorChanges);
+        READWRITE(privacyData.spentSerials);
 
         //POS params
         if(IsProofOfStakeHeightActive(Params().GetConsensus().nPosHeightActivate)){
@@ -512,9 +564,9 @@ public:
 
         // sigma params
         if(IsSigmaHeightActive(Params().GetConsensus().nSigmaStartBlock)){
-            READWRITE(mintedPubCoinsV2);
-            READWRITE(accumulatorChangesV2);
-            READWRITE(spentSerialsV2);
+            READWRITE(privacyData.mintedPubCoinsV2);
+            READWRITE(privacyData.accumulatorChangesV2);
+            READWRITE(privacyData.spentSerialsV2);
         }
 
     }
@@ -175,6 +175,9 @@ public:
         // By default assume that the signatures in ancestors of this block are valid.
         //consensus.defaultAssumeValid = uint256S("0xe734db844dfe5a7a06ec42a71c0540f723033830be91bb59524b6e9acbd3345b"); //506067
 
+        // By default assume that the Zerocoin spend proofs in ancestors of this block are valid.
+        consensus.defaultPrivacyAssumeValid = uint256S("0x06deb41e2f7230f31ca029a7cfb8a49fb3bd29368963e773afabfff3bbb55d36"); //399211
+
 
         // ghostnode params
         consensus.nGhostnodeMinimumConfirmations = 1;
@@ -340,6 +343,7 @@ public:
 
         // By default assume that the signatures in ancestors of this block are valid.
         //consensus.defaultAssumeValid = uint256S("0xe734db844dfe5a7a06ec42a71c0540f723033830be91bb59524b6e9acbd3345b"); //1135275
+        consensus.defaultPrivacyAssumeValid = uint256S("0x00");
 
         // ghostnode params
         consensus.nGhostnodeMinimumConfirmations = 1;
@@ -509,6 +513,7 @@ public:
 
         // By default assume that the signatures in ancestors of this block are valid.
         consensus.defaultAssumeValid = uint256S("0x00");
+        consensus.defaultPrivacyAssumeValid = uint256S("0x00");
 
         pchMessageStart[0] = 0xfa;
         pchMessageStart[1] = 0xbf;
@@ -82,6 +82,8 @@ struct Params {
     int64_t DifficultyAdjustmentInterval() const { return nPowTargetTimespan / nPowTargetSpacing; }
     uint256 nMinimumChainWork;
     uint256 defaultAssumeValid;
+    /** Zerocoin spend proofs of this block and its ancestors are assumed valid, their serials are still tracked */
+    uint256 defaultPrivacyAssumeValid;
 
     int nInstantSendKeepLock; // in blocks
 
@@ -223,15 +223,11 @@ bool CheckTransaction(const CTransaction& tx, CValidationState& state, uint256 h
                 }
             }
             else if(tx.IsSigmaSpend()){
-                for(const CTxIn &txin: tx.vin){
-                    if(!txin.scriptSig.IsSigmaSpend()) {
+                for(unsigned int i = 0; i < tx.vin.size(); i++){
+                    if(!tx.vin[i].scriptSig.IsSigmaSpend()) {
                         return false;
                     }
-                    CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 1),
-                                                    (const char *)&*txin.scriptSig.end(),
-                                                    SER_NETWORK, PROTOCOL_VERSION);
-                    sigma::CoinSpend newSpend(SParams, serializedCoinSpend);
-                    totalIn += newSpend.getIntDenomination();
+                    totalIn += GetSigmaSpend(tx, i)->getIntDenomination();
                 }
             }
             if(totalOut > totalIn)
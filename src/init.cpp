@@ -26,6 +26,7 @@
 #include <netbase.h>
 #include <net.h>
 #include <net_processing.h>
+#include <parallel.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -36,6 +37,7 @@
 #include <script/standard.h>
 #include <script/sigcache.h>
 #include <scheduler.h>
+#include <secp256k1/include/MultiExponent.h>
 #include <timedata.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -44,6 +46,7 @@
 #include <util.h>
 #include <utilmoneystr.h>
 #include <validationinterface.h>
+#include <zerocoin/sigma.h>
 #ifdef ENABLE_WALLET
 #include <wallet/init.h>
 #endif
@@ -347,6 +350,8 @@ void Shutdown()
     // CScheduler/checkqueue threadGroup
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    secp_primitives::MultiExponent::set_thread_count(1);
+    StopParallelExecutor();
 
     if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -388,6 +393,7 @@ void Shutdown()
         pcoinscatcher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
+        pprivacyindex.reset();
     }
 #ifdef ENABLE_WALLET
     StopWallets();
@@ -477,6 +483,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-assumevalidprivacy=<hex>", strprintf(_("If this block is in the chain assume that the Zerocoin spend proofs of it and its ancestors are valid and skip their verification, spent serials are still checked (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultPrivacyAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultPrivacyAssumeValid.GetHex()));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -503,6 +510,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-sigmaverifythreads=<n>", strprintf(_("Set the number of threads used to verify and create Sigma proofs (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
+        -GetNumCores(), MAX_SIGMA_VERIFY_THREADS, DEFAULT_SIGMA_VERIFY_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -1148,6 +1157,12 @@ bool AppInitParameterInteraction()
     else
         LogPrintf("Validating signatures for all blocks.\n");
 
+    hashPrivacyAssumeValid = uint256S(gArgs.GetArg("-assumevalidprivacy", chainparams.GetConsensus().defaultPrivacyAssumeValid.GetHex()));
+    if (!hashPrivacyAssumeValid.IsNull())
+        LogPrintf("Assuming ancestors of block %s have valid Zerocoin spend proofs.\n", hashPrivacyAssumeValid.GetHex());
+    else
+        LogPrintf("Validating Zerocoin spend proofs for all blocks.\n");
+
     if (gArgs.IsArgSet("-minimumchainwork")) {
         const std::string minChainWorkStr = gArgs.GetArg("-minimumchainwork", "");
         if (!IsHexNumber(minChainWorkStr)) {
@@ -1394,13 +1409,23 @@ bool AppInitMain()
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitSigmaProofCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadSigmaSpendCheck);
+        }
     }
 
+    int nSigmaVerifyThreads = gArgs.GetArg("-sigmaverifythreads", DEFAULT_SIGMA_VERIFY_THREADS);
+    if (nSigmaVerifyThreads <= 0)
+        nSigmaVerifyThreads += GetNumCores();
+    nSigmaVerifyThreads = std::max(1, std::min(nSigmaVerifyThreads, MAX_SIGMA_VERIFY_THREADS));
+    LogPrintf("Using %u threads for Sigma multi-exponentiation\n", nSigmaVerifyThreads);
+    secp_primitives::MultiExponent::set_thread_count(nSigmaVerifyThreads);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1604,6 +1629,8 @@ bool AppInitMain()
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    int64_t nPrivacyIndexDBCache = std::min(nTotalCache / 8, nMaxPrivacyIndexDBCache << 20);
+    nTotalCache -= nPrivacyIndexDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1611,6 +1638,7 @@ bool AppInitMain()
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for privacy index database\n", nPrivacyIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1632,6 +1660,8 @@ bool AppInitMain()
                 // fails if it's still open from the previous loop. Close it first:
                 pblocktree.reset();
                 pblocktree.reset(new CBlockTreeDB(nBlockTreeDBCache, false, fReset));
+                pprivacyindex.reset();
+                pprivacyindex.reset(new CPrivacyIndexDB(nPrivacyIndexDBCache, false, fReset));
 
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
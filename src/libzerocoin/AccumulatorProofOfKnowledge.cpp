@@ -11,9 +11,71 @@
  **/
 
 #include "libzerocoin/Zerocoin.h"
+#include "libzerocoin/MontgomeryGroup.h"
+
+#include <memory>
+#include <mutex>
 
 namespace libzerocoin {
 
+namespace {
+
+    // Montgomery groups and tables of the fixed bases of the proof, sg and sh of the commitment group with a known
+    // order, g_n and h_n of the group of hidden order mod N
+    struct PoKPrecomputation {
+        IntegerGroupParams pokGroup;
+        IntegerGroupParams qrnGroup;
+        Bignum accumulatorModulus;
+
+        MontgomeryGroup pokModulusGroup;
+        FixedBase sg, sh;
+        MontgomeryGroup accumulatorGroup;
+        FixedBase g_n, h_n;
+
+        // The largest exponents of g_n and h_n are s_beta and s_delta, which are up to N/4 * modulus of the
+        // commitment group * 2^(k' + k'') in size
+        static int GetMaxExponentBits(const AccumulatorAndProofParams *params) {
+            return params->accumulatorModulus.bitSize() +
+                   std::max(params->accumulatorPoKCommitmentGroup.modulus.bitSize() + (int) (params->k_prime + params->k_dprime),
+                            params->maxCoinValue.bitSize() + 256);
+        }
+
+        explicit PoKPrecomputation(const AccumulatorAndProofParams *params)
+                : pokGroup(params->accumulatorPoKCommitmentGroup), qrnGroup(params->accumulatorQRNCommitmentGroup),
+                  accumulatorModulus(params->accumulatorModulus),
+                  pokModulusGroup(pokGroup.modulus),
+                  sg(pokModulusGroup, pokGroup.g, pokGroup.groupOrder, pokGroup.groupOrder.bitSize()),
+                  sh(pokModulusGroup, pokGroup.h, pokGroup.groupOrder, pokGroup.groupOrder.bitSize()),
+                  accumulatorGroup(accumulatorModulus),
+                  g_n(accumulatorGroup, qrnGroup.g, Bignum(0), GetMaxExponentBits(params)),
+                  h_n(accumulatorGroup, qrnGroup.h, Bignum(0), GetMaxExponentBits(params)) {}
+
+        bool Matches(const AccumulatorAndProofParams *params) const {
+            const IntegerGroupParams &pok = params->accumulatorPoKCommitmentGroup;
+            const IntegerGroupParams &qrn = params->accumulatorQRNCommitmentGroup;
+            return pok.g == pokGroup.g && pok.h == pokGroup.h && pok.modulus == pokGroup.modulus &&
+                   pok.groupOrder == pokGroup.groupOrder && qrn.g == qrnGroup.g && qrn.h == qrnGroup.h &&
+                   params->accumulatorModulus == accumulatorModulus;
+        }
+    };
+
+    // Built for the parameters last used. NULL if a modulus doesn't allow Montgomery multiplication or a fixed base
+    // has no inverse, the proof is then verified with pow_mod
+    std::shared_ptr<const PoKPrecomputation> GetPrecomputation(const AccumulatorAndProofParams *params) {
+        static std::mutex cs;
+        static std::shared_ptr<const PoKPrecomputation> precomputation;
+
+        std::lock_guard<std::mutex> lock(cs);
+        if (!precomputation || !precomputation->Matches(params))
+            precomputation = std::make_shared<const PoKPrecomputation>(params);
+        if (!precomputation->sg.IsValid() || !precomputation->sh.IsValid() ||
+            !precomputation->g_n.IsValid() || !precomputation->h_n.IsValid())
+            return nullptr;
+        return precomputation;
+    }
+
+}
+
     AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndProofParams *p) : params(p) {}
 
     AccumulatorProofOfKnowledge::AccumulatorProofOfKnowledge(const AccumulatorAndProofParams *p,
@@ -144,38 +206,89 @@ namespace libzerocoin {
 
         Bignum c = Bignum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-        Bignum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
-                                                                                              sg.inverse(
-                                                                                                      params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(
-                s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) *
-                             sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             (sg * valueOfCommitmentToCoin).pow_mod(s_sigma,
-                                                                    params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-
-        Bignum t_1_prime =
-                (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-        Bignum t_2_prime =
-                (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-
-        Bignum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) *
-                            C_u.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
-
-        Bignum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) *
-                            ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
+        Bignum st_1_prime, st_2_prime, st_3_prime, t_1_prime, t_2_prime, t_3_prime, t_4_prime;
+
+        std::shared_ptr<const PoKPrecomputation> precomputation = GetPrecomputation(params);
+        if (precomputation) {
+            const MontgomeryGroup &pokGroup = precomputation->pokModulusGroup;
+            const MontgomeryGroup &accumulatorGroup = precomputation->accumulatorGroup;
+
+            MultiExponentiation st_1_terms(pokGroup);
+            st_1_terms.Add(valueOfCommitmentToCoin, c);
+            st_1_terms.Add(precomputation->sg, s_alpha);
+            st_1_terms.Add(precomputation->sh, s_phi);
+            st_1_prime = st_1_terms.Compute();
+
+            MultiExponentiation st_2_terms(pokGroup);
+            st_2_terms.Add(precomputation->sg, c);
+            st_2_terms.Add(valueOfCommitmentToCoin * sg.inverse(params->accumulatorPoKCommitmentGroup.modulus), s_gamma);
+            st_2_terms.Add(precomputation->sh, s_psi);
+            st_2_prime = st_2_terms.Compute();
+
+            MultiExponentiation st_3_terms(pokGroup);
+            st_3_terms.Add(precomputation->sg, c);
+            st_3_terms.Add(sg * valueOfCommitmentToCoin, s_sigma);
+            st_3_terms.Add(precomputation->sh, s_xi);
+            st_3_prime = st_3_terms.Compute();
+
+            MultiExponentiation t_1_terms(accumulatorGroup);
+            t_1_terms.Add(C_r, c);
+            t_1_terms.Add(precomputation->h_n, s_zeta);
+            t_1_terms.Add(precomputation->g_n, s_epsilon);
+            t_1_prime = t_1_terms.Compute();
+
+            MultiExponentiation t_2_terms(accumulatorGroup);
+            t_2_terms.Add(C_e, c);
+            t_2_terms.Add(precomputation->h_n, s_eta);
+            t_2_terms.Add(precomputation->g_n, s_alpha);
+            t_2_prime = t_2_terms.Compute();
+
+            // (h_n^-1)^s = h_n^-s
+            MultiExponentiation t_3_terms(accumulatorGroup);
+            t_3_terms.Add(a.getValue(), c);
+            t_3_terms.Add(C_u, s_alpha);
+            t_3_terms.Add(precomputation->h_n, Bignum(0) - s_beta);
+            t_3_prime = t_3_terms.Compute();
+
+            MultiExponentiation t_4_terms(accumulatorGroup);
+            t_4_terms.Add(C_r, s_alpha);
+            t_4_terms.Add(precomputation->h_n, Bignum(0) - s_delta);
+            t_4_terms.Add(precomputation->g_n, Bignum(0) - s_beta);
+            t_4_prime = t_4_terms.Compute();
+        } else {
+            st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
+                                 sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
+                                 sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
+                                params->accumulatorPoKCommitmentGroup.modulus;
+            st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
+                                                                                                  sg.inverse(
+                                                                                                          params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(
+                    s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) *
+                                 sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
+                                params->accumulatorPoKCommitmentGroup.modulus;
+            st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
+                                 (sg * valueOfCommitmentToCoin).pow_mod(s_sigma,
+                                                                        params->accumulatorPoKCommitmentGroup.modulus) *
+                                 sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
+                                params->accumulatorPoKCommitmentGroup.modulus;
+
+            t_1_prime =
+                    (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) *
+                     g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
+            t_2_prime =
+                    (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) *
+                     g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
+
+            t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) *
+                                C_u.pow_mod(s_alpha, params->accumulatorModulus) *
+                                ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
+                               params->accumulatorModulus;
+
+            t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) *
+                                ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) *
+                                ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
+                               params->accumulatorModulus;
+        }
 
         bool result = false;
 
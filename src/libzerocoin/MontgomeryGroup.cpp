@@ -0,0 +1,216 @@
+#include "MontgomeryGroup.h"
+
+namespace libzerocoin {
+
+static const int FIXED_BASE_WINDOW = 4;
+static const int FIXED_BASE_DIGITS = (1 << FIXED_BASE_WINDOW) - 1;
+
+// Bits [nPos, nPos + nWindow) of a non-negative exponent
+static unsigned int GetWindow(const Bignum &exponent, int nPos, int nWindow) {
+    unsigned int nDigit = 0;
+    for (int j = nWindow - 1; j >= 0; j--)
+        nDigit = (nDigit << 1) | (BN_is_bit_set(&exponent, nPos + j) ? 1 : 0);
+    return nDigit;
+}
+
+MontgomeryGroup::MontgomeryGroup(const Bignum &modulusIn) : modulus(modulusIn), mont(NULL) {
+    if (BN_is_negative(&modulus) || !BN_is_odd(&modulus) || BN_is_one(&modulus))
+        return;
+
+    CAutoBN_CTX ctx;
+    mont = BN_MONT_CTX_new();
+    if (mont == NULL)
+        throw bignum_error("MontgomeryGroup : BN_MONT_CTX_new failed");
+    if (!BN_MONT_CTX_set(mont, &modulus, ctx)) {
+        BN_MONT_CTX_free(mont);
+        throw bignum_error("MontgomeryGroup : BN_MONT_CTX_set failed");
+    }
+    ToMontgomery(one, Bignum(1), ctx);
+}
+
+MontgomeryGroup::~MontgomeryGroup() {
+    if (mont)
+        BN_MONT_CTX_free(mont);
+}
+
+void MontgomeryGroup::ToMontgomery(Bignum &r, const Bignum &a, BN_CTX *ctx) const {
+    Bignum reduced;
+    if (!BN_nnmod(&reduced, &a, &modulus, ctx) || !BN_to_montgomery(&r, &reduced, mont, ctx))
+        throw bignum_error("MontgomeryGroup::ToMontgomery : BN_to_montgomery failed");
+}
+
+void MontgomeryGroup::FromMontgomery(Bignum &r, const Bignum &a, BN_CTX *ctx) const {
+    if (!BN_from_montgomery(&r, &a, mont, ctx))
+        throw bignum_error("MontgomeryGroup::FromMontgomery : BN_from_montgomery failed");
+}
+
+void MontgomeryGroup::Mul(Bignum &r, const Bignum &a, const Bignum &b, BN_CTX *ctx) const {
+    if (!BN_mod_mul_montgomery(&r, &a, &b, mont, ctx))
+        throw bignum_error("MontgomeryGroup::Mul : BN_mod_mul_montgomery failed");
+}
+
+FixedBase::FixedBase(const MontgomeryGroup &groupIn, const Bignum &baseIn, const Bignum &orderIn, int nMaxExponentBits)
+    : group(groupIn), base(baseIn), order(0), nTableBits(0), fValid(false) {
+
+    if (!group.IsValid())
+        return;
+
+    CAutoBN_CTX ctx;
+    if (!BN_mod_inverse(&inverse, &base, &group.getModulus(), ctx))
+        return;
+
+    // A wrong order would change the results, it is used only when it is the order of the base indeed
+    if (orderIn > 0 && base.pow_mod(orderIn, group.getModulus()) == 1) {
+        order = orderIn;
+        nMaxExponentBits = std::max(nMaxExponentBits, order.bitSize());
+    }
+
+    int nWindows = (nMaxExponentBits + FIXED_BASE_WINDOW - 1) / FIXED_BASE_WINDOW;
+    nTableBits = nWindows * FIXED_BASE_WINDOW;
+    table.resize((size_t)nWindows * FIXED_BASE_DIGITS);
+
+    // power = base^(16^i), the row of window i holds its multiples power^d
+    Bignum power;
+    group.ToMontgomery(power, base, ctx);
+    for (int i = 0; i < nWindows; i++) {
+        size_t nRow = (size_t)i * FIXED_BASE_DIGITS;
+        table[nRow] = power;
+        for (int d = 1; d < FIXED_BASE_DIGITS; d++)
+            group.Mul(table[nRow + d], table[nRow + d - 1], power, ctx);
+        group.Mul(power, table[nRow + FIXED_BASE_DIGITS - 1], power, ctx);
+    }
+
+    fValid = true;
+}
+
+void MultiExponentiation::Add(const FixedBase &base, const Bignum &exponent) {
+    if (!base.IsValid()) {
+        Add(base.getBase(), exponent);
+        return;
+    }
+
+    FixedTerm term;
+    term.base = &base;
+    term.fInverse = false;
+    if (base.order > 0) {
+        CAutoBN_CTX ctx;
+        if (!BN_nnmod(&term.exponent, &exponent, &base.order, ctx))
+            throw bignum_error("MultiExponentiation::Add : BN_nnmod failed");
+    } else if (exponent < 0) {
+        term.exponent = exponent * -1;
+        term.fInverse = true;
+    } else {
+        term.exponent = exponent;
+    }
+
+    if (term.exponent.bitSize() > base.nTableBits) {
+        // Too large for the table, the inverse is known so this can't fail
+        terms.push_back(std::make_pair(term.fInverse ? base.inverse : base.base, term.exponent));
+        return;
+    }
+    if (term.exponent != 0)
+        fixedTerms.push_back(term);
+}
+
+void MultiExponentiation::Add(const Bignum &base, const Bignum &exponent) {
+    if (!group.IsValid()) {
+        terms.push_back(std::make_pair(base, exponent));
+        return;
+    }
+
+    if (exponent == 0)
+        return;
+
+    CAutoBN_CTX ctx;
+    Bignum reduced;
+    if (exponent < 0) {
+        // g^-x = (g^-1)^x, throws like pow_mod if g has no inverse
+        reduced = base.inverse(group.getModulus());
+        terms.push_back(std::make_pair(reduced, exponent * -1));
+    } else {
+        if (!BN_nnmod(&reduced, &base, &group.getModulus(), ctx))
+            throw bignum_error("MultiExponentiation::Add : BN_nnmod failed");
+        terms.push_back(std::make_pair(reduced, exponent));
+    }
+}
+
+Bignum MultiExponentiation::Compute() const {
+    const Bignum &modulus = group.getModulus();
+
+    if (!group.IsValid()) {
+        Bignum product = 1;
+        for (const std::pair<Bignum, Bignum> &term : terms)
+            product = product * term.first.pow_mod(term.second, modulus);
+        return product % modulus;
+    }
+
+    CAutoBN_CTX ctx;
+    Bignum result = group.One();
+
+    // Fixed bases: one table entry per non-zero window. Those raised to the power of a negative exponent are
+    // multiplied into inverted and the product is inverted once
+    Bignum inverted = group.One();
+    bool fInverted = false;
+    for (const FixedTerm &term : fixedTerms) {
+        Bignum &acc = term.fInverse ? inverted : result;
+        fInverted |= term.fInverse;
+        int nWindows = (term.exponent.bitSize() + FIXED_BASE_WINDOW - 1) / FIXED_BASE_WINDOW;
+        for (int i = 0; i < nWindows; i++) {
+            unsigned int nDigit = GetWindow(term.exponent, i * FIXED_BASE_WINDOW, FIXED_BASE_WINDOW);
+            if (nDigit != 0)
+                group.Mul(acc, acc, term.base->table[(size_t)i * FIXED_BASE_DIGITS + nDigit - 1], ctx);
+        }
+    }
+
+    // Other bases: windows from the top down with the squarings shared by all of them
+    if (!terms.empty()) {
+        int nMaxBits = 0;
+        for (const std::pair<Bignum, Bignum> &term : terms)
+            nMaxBits = std::max(nMaxBits, term.second.bitSize());
+        int nWindow = nMaxBits > 512 ? 5 : (nMaxBits > 128 ? 4 : 3);
+        int nDigits = 1 << nWindow;
+
+        // powers[k * nDigits + d] = base_k^d in Montgomery form
+        std::vector<Bignum> powers(terms.size() * nDigits);
+        for (size_t k = 0; k < terms.size(); k++) {
+            size_t nRow = k * nDigits;
+            powers[nRow] = group.One();
+            group.ToMontgomery(powers[nRow + 1], terms[k].first, ctx);
+            for (int d = 2; d < nDigits; d++)
+                group.Mul(powers[nRow + d], powers[nRow + d - 1], powers[nRow + 1], ctx);
+        }
+
+        Bignum acc = group.One();
+        bool fStarted = false;
+        int nWindows = (nMaxBits + nWindow - 1) / nWindow;
+        for (int i = nWindows - 1; i >= 0; i--) {
+            if (fStarted) {
+                for (int j = 0; j < nWindow; j++)
+                    group.Mul(acc, acc, acc, ctx);
+            }
+            for (size_t k = 0; k < terms.size(); k++) {
+                unsigned int nDigit = GetWindow(terms[k].second, i * nWindow, nWindow);
+                if (nDigit == 0)
+                    continue;
+                if (fStarted) {
+                    group.Mul(acc, acc, powers[k * nDigits + nDigit], ctx);
+                } else {
+                    acc = powers[k * nDigits + nDigit];
+                    fStarted = true;
+                }
+            }
+        }
+        group.Mul(result, result, acc, ctx);
+    }
+
+    Bignum ret;
+    group.FromMontgomery(ret, result, ctx);
+    if (fInverted) {
+        Bignum product;
+        group.FromMontgomery(product, inverted, ctx);
+        ret = ret.mul_mod(product.inverse(modulus), modulus);
+    }
+    return ret;
+}
+
+} /* namespace libzerocoin */
@@ -0,0 +1,94 @@
+#ifndef MONTGOMERYGROUP_H
+#define MONTGOMERYGROUP_H
+
+#include <algorithm>
+#include <vector>
+
+#include "libzerocoin/Zerocoin.h"
+
+namespace libzerocoin {
+
+// Arithmetic modulo an odd modulus on the Montgomery multiplication of OpenSSL. Values are kept in Montgomery
+// form while a product of powers is computed, so every step is one multiplication without a division
+class MontgomeryGroup {
+private:
+    Bignum modulus;
+    BN_MONT_CTX *mont;
+    // 1 in Montgomery form
+    Bignum one;
+
+public:
+    explicit MontgomeryGroup(const Bignum &modulus);
+    ~MontgomeryGroup();
+
+    MontgomeryGroup(const MontgomeryGroup&) = delete;
+    MontgomeryGroup& operator=(const MontgomeryGroup&) = delete;
+
+    // false unless the modulus is odd and greater than one, exponentiations then fall back to pow_mod
+    bool IsValid() const { return mont != NULL; }
+    const Bignum &getModulus() const { return modulus; }
+    const Bignum &One() const { return one; }
+
+    // a is reduced modulo the modulus first, it may be negative or larger than the modulus
+    void ToMontgomery(Bignum &r, const Bignum &a, BN_CTX *ctx) const;
+    void FromMontgomery(Bignum &r, const Bignum &a, BN_CTX *ctx) const;
+    void Mul(Bignum &r, const Bignum &a, const Bignum &b, BN_CTX *ctx) const;
+};
+
+// A base that is raised to many exponents, e.g. a generator of the parameters. Its powers base^(d * 16^i) are
+// computed once, base^e then costs one multiplication per four bits of e and no squaring
+class FixedBase {
+private:
+    friend class MultiExponentiation;
+
+    const MontgomeryGroup &group;
+    Bignum base;
+    Bignum inverse;
+    // order of the base, zero when it isn't known. Exponents are reduced modulo the order
+    Bignum order;
+    // table[15 * i + d - 1] = base^(d * 16^i) in Montgomery form
+    std::vector<Bignum> table;
+    int nTableBits;
+    bool fValid;
+
+public:
+    // order may be zero when it isn't known, it is used only after base^order == 1 is checked. Exponents of up to
+    // nMaxExponentBits bits use the table, larger ones are computed like those of any other base
+    FixedBase(const MontgomeryGroup &group, const Bignum &base, const Bignum &order, int nMaxExponentBits);
+
+    FixedBase(const FixedBase&) = delete;
+    FixedBase& operator=(const FixedBase&) = delete;
+
+    // false if the group is invalid or the base has no inverse
+    bool IsValid() const { return fValid; }
+    const Bignum &getBase() const { return base; }
+};
+
+// A product of powers modulo the modulus of a group. The squarings are shared by all the bases that aren't fixed,
+// the result is the same as the product of pow_mod of every term, including a bignum_error for a negative
+// exponent of a base that has no inverse
+class MultiExponentiation {
+private:
+    struct FixedTerm {
+        const FixedBase *base;
+        Bignum exponent;
+        bool fInverse;
+    };
+
+    const MontgomeryGroup &group;
+    std::vector<FixedTerm> fixedTerms;
+    // (base, exponent) with a non-negative exponent and the base reduced
+    std::vector<std::pair<Bignum, Bignum>> terms;
+
+public:
+    explicit MultiExponentiation(const MontgomeryGroup &group) : group(group) {}
+
+    void Add(const FixedBase &base, const Bignum &exponent);
+    void Add(const Bignum &base, const Bignum &exponent);
+
+    Bignum Compute() const;
+};
+
+} /* namespace libzerocoin */
+
+#endif // MONTGOMERYGROUP_H
@@ -1,23 +1,25 @@
 #ifndef PARALLELTASKS_H
 #define PARALLELTASKS_H
 
-#include <vector>
+#include <deque>
 #include <functional>
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-
 #include "libzerocoin/Zerocoin.h"
-#include <boost/thread/future.hpp>
+#include "parallel.h"
 #include <boost/thread.hpp>
 
 namespace libzerocoin {
 
+// Tasks run on the shared executor of parallel.h
 class ParallelTasks {
 private:
-    vector<boost::future<void>> tasks;
+    std::deque<std::function<void()>> functions;
+    std::deque<CParallelTask> tasks;
+    CParallelTaskGroup group;
 
 public:
     ParallelTasks(int n=0);
+    ~ParallelTasks();
 
     // add new task
     void Add(std::function<void()> task);
@@ -25,9 +27,20 @@ public:
     // wait for everything added so far
     void Wait();
 
-    // clear all the tasks from the waiting list
+    // wait for everything added so far and clear the list of tasks
     void Reset();
 
+    // call func(i) for every i in [0, n) in chunks and wait for it
+    template <typename Func>
+    static void For(std::size_t n, const Func &func) {
+#ifdef ZEROCOIN_THREADING
+        ParallelFor(n, 1, func);
+#else
+        for (std::size_t i = 0; i < n; i++)
+            func(i);
+#endif
+    }
+
     // helper class to put thread interruption on pause
     class DoNotDisturb {
     private:
@@ -12,9 +12,60 @@
 
 #include "libzerocoin/Zerocoin.h"
 #include "libzerocoin/ParallelTasks.h"
+#include "libzerocoin/MontgomeryGroup.h"
+
+#include <memory>
+#include <mutex>
 
 namespace libzerocoin {
 
+namespace {
+
+// Montgomery groups and tables of the fixed bases of the proof. a and b are raised to the power of exponents
+// modulo the order of the SoK group, g and h modulo its modulus
+struct SoKPrecomputation {
+	IntegerGroupParams coinGroup;
+	IntegerGroupParams sokGroup;
+
+	MontgomeryGroup orderGroup;
+	FixedBase a, b;
+	MontgomeryGroup modulusGroup;
+	FixedBase g, h;
+
+	explicit SoKPrecomputation(const Params* params)
+		: coinGroup(params->coinCommitmentGroup), sokGroup(params->serialNumberSoKCommitmentGroup),
+		  orderGroup(sokGroup.groupOrder),
+		  a(orderGroup, coinGroup.g, coinGroup.groupOrder, coinGroup.groupOrder.bitSize()),
+		  b(orderGroup, coinGroup.h, coinGroup.groupOrder, coinGroup.groupOrder.bitSize()),
+		  modulusGroup(sokGroup.modulus),
+		  g(modulusGroup, sokGroup.g, sokGroup.groupOrder, sokGroup.groupOrder.bitSize()),
+		  h(modulusGroup, sokGroup.h, sokGroup.groupOrder, sokGroup.groupOrder.bitSize()) {}
+
+	bool Matches(const Params* params) const {
+		const IntegerGroupParams& coin = params->coinCommitmentGroup;
+		const IntegerGroupParams& sok = params->serialNumberSoKCommitmentGroup;
+		return coin.g == coinGroup.g && coin.h == coinGroup.h && coin.groupOrder == coinGroup.groupOrder &&
+			sok.g == sokGroup.g && sok.h == sokGroup.h && sok.modulus == sokGroup.modulus &&
+			sok.groupOrder == sokGroup.groupOrder;
+	}
+};
+
+// Built for the parameters last used. NULL if the moduli don't allow Montgomery multiplication, the proof is
+// then computed with pow_mod
+std::shared_ptr<const SoKPrecomputation> GetPrecomputation(const Params* params) {
+	static std::mutex cs;
+	static std::shared_ptr<const SoKPrecomputation> precomputation;
+
+	std::lock_guard<std::mutex> lock(cs);
+	if (!precomputation || !precomputation->Matches(params))
+		precomputation = std::make_shared<const SoKPrecomputation>(params);
+	if (!precomputation->orderGroup.IsValid() || !precomputation->modulusGroup.IsValid())
+		return nullptr;
+	return precomputation;
+}
+
+} // namespace
+
 SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params* p): params(p) { }
 
 SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params* p, const PrivateCoin& coin, const Commitment& commitmentToCoin, uint256 msghash)
@@ -56,15 +107,10 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 	// instead we generate the random values beforehand and run the calculations
 	// based on those values in parallel.
 
-    ParallelTasks challenges(params->zkp_iterations);
-
-	for(uint32_t i=0; i < params->zkp_iterations; i++) {
-		// compute g^{ {a^x b^r} h^v} mod p2
-        challenges.Add([this, i, &coin, &c, &r, &v] {
-            c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i]);
-        });
-	}
-    challenges.Wait();
+	// compute g^{ {a^x b^r} h^v} mod p2
+    ParallelTasks::For(params->zkp_iterations, [this, &coin, &c, &r, &v](std::size_t i) {
+        c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i]);
+    });
 
 	// We can't hash data in parallel either
 	// because OPENMP cannot not guarantee loops
@@ -75,8 +121,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
     this->hash = hasher.GetArith256Hash();
 	unsigned char *hashbytes =  (unsigned char*) &hash;
 
-    challenges.Reset();
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+    ParallelTasks::For(params->zkp_iterations, [this, hashbytes, &r, &v, &b, &commitmentToCoin, &coin](std::size_t i) {
 		int bit = i % 8;
 		int byte = i / 8;
 
@@ -85,19 +130,28 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 			s_notprime[i]       = r[i];
 			sprime[i]           = v[i];
 		} else {
-            challenges.Add([this, i, &r, &v, &b, &commitmentToCoin, &coin] {
-                s_notprime[i]   = r[i] - coin.getRandomness();
-                sprime[i]       = v[i] - (commitmentToCoin.getRandomness() *
-			                              b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
-            });
+            s_notprime[i]   = r[i] - coin.getRandomness();
+            sprime[i]       = v[i] - (commitmentToCoin.getRandomness() *
+                                      b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
 		}
-    }
-    challenges.Wait();
+    });
 }
 
 inline Bignum SerialNumberSignatureOfKnowledge::challengeCalculation(const Bignum& a_exp,const Bignum& b_exp,
         const Bignum& h_exp) const {
 
+	std::shared_ptr<const SoKPrecomputation> precomputation = GetPrecomputation(params);
+	if (precomputation) {
+		MultiExponentiation exponent(precomputation->orderGroup);
+		exponent.Add(precomputation->a, a_exp);
+		exponent.Add(precomputation->b, b_exp);
+
+		MultiExponentiation result(precomputation->modulusGroup);
+		result.Add(precomputation->g, exponent.Compute());
+		result.Add(precomputation->h, h_exp);
+		return result.Compute();
+	}
+
 	Bignum a = params->coinCommitmentGroup.g;
 	Bignum b = params->coinCommitmentGroup.h;
 	Bignum g = params->serialNumberSoKCommitmentGroup.g;
@@ -132,25 +186,29 @@ bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, co
 
 	vector<CBigNum> tprime(params->zkp_iterations);
 	unsigned char *hashbytes = (unsigned char*) &this->hash;
-
-    ParallelTasks challenges(params->zkp_iterations);
-
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
-        challenges.Add([this, i, hashbytes, &b, &h, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin] {
-            int bit = i % 8;
-            int byte = i / 8;
-            bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
-            if(challenge_bit) {
-                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
-            } else {
-                Bignum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-                tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-                             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
-                            params->serialNumberSoKCommitmentGroup.modulus;
-            }
-        });
-	}
-    challenges.Wait();
+	std::shared_ptr<const SoKPrecomputation> precomputation = GetPrecomputation(params);
+
+    ParallelTasks::For(params->zkp_iterations, [this, hashbytes, &b, &h, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin, &precomputation](std::size_t i) {
+        int bit = i % 8;
+        int byte = i / 8;
+        bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
+        if(challenge_bit) {
+            tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
+        } else if (precomputation) {
+            MultiExponentiation exp(precomputation->orderGroup);
+            exp.Add(precomputation->b, s_notprime[i]);
+
+            MultiExponentiation result(precomputation->modulusGroup);
+            result.Add(valueOfCommitmentToCoin, exp.Compute());
+            result.Add(precomputation->h, sprime[i]);
+            tprime[i] = result.Compute();
+        } else {
+            Bignum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
+            tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
+                         (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
+                        params->serialNumberSoKCommitmentGroup.modulus;
+        }
+    });
 
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
 		hasher << tprime[i];
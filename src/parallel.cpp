@@ -0,0 +1,217 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <parallel.h>
+
+#include <util.h>
+
+#include <assert.h>
+
+namespace {
+
+// Executor and queue of the worker running on this thread, if any
+thread_local CParallelExecutor *pCurrentExecutor = nullptr;
+thread_local int nCurrentWorker = -1;
+
+std::mutex csExecutor;
+std::unique_ptr<CParallelExecutor> executor;
+
+} // namespace
+
+CParallelExecutor::CParallelExecutor(int nWorkers) : fShutdown(false), nQueued(0), nTasks(0), nSteals(0), nNextWorker(0)
+{
+    assert(nWorkers > 0);
+    for (int i = 0; i < nWorkers; i++)
+        workers.emplace_back(new Worker());
+    for (int i = 0; i < nWorkers; i++)
+        threads.emplace_back(&CParallelExecutor::ThreadWorker, this, i);
+}
+
+CParallelExecutor::~CParallelExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fShutdown = true;
+    }
+    cond.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void CParallelExecutor::ThreadWorker(int nWorker)
+{
+    RenameThread(strprintf("nix-par.%d", nWorker).c_str());
+    pCurrentExecutor = this;
+    nCurrentWorker = nWorker;
+
+    for (;;) {
+        CParallelTask *task = Take();
+        if (task) {
+            Run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return fShutdown || nQueued.load() > 0; });
+        if (fShutdown && nQueued.load() == 0)
+            return;
+    }
+}
+
+CParallelTask *CParallelExecutor::Take()
+{
+    if (nQueued.load() == 0)
+        return nullptr;
+
+    int nSelf = pCurrentExecutor == this ? nCurrentWorker : -1;
+    if (nSelf >= 0) {
+        Worker &worker = *workers[nSelf];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            CParallelTask *task = worker.tasks.back();
+            worker.tasks.pop_back();
+            nQueued--;
+            return task;
+        }
+    }
+
+    // Steal the oldest task of another queue, the one most likely to be a large piece of work
+    std::size_t nWorkers = workers.size();
+    std::size_t nStart = nSelf >= 0 ? nSelf + 1 : nNextWorker.load();
+    for (std::size_t i = 0; i < nWorkers; i++) {
+        std::size_t nVictim = (nStart + i) % nWorkers;
+        if ((int)nVictim == nSelf)
+            continue;
+        Worker &worker = *workers[nVictim];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            CParallelTask *task = worker.tasks.front();
+            worker.tasks.pop_front();
+            nQueued--;
+            nSteals++;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void CParallelExecutor::Run(CParallelTask *task)
+{
+    CParallelTaskGroup &group = *task->group;
+    std::exception_ptr error;
+    try {
+        task->pfn(task->ctx, task->begin, task->end);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    nTasks++;
+
+    // The waiting thread leaves only after taking the mutex of the group, so the group is alive until it is
+    // released here
+    std::lock_guard<std::mutex> lock(group.mutex);
+    if (error && !group.error)
+        group.error = error;
+    if (--group.nRemaining == 0)
+        group.cond.notify_all();
+}
+
+void CParallelExecutor::Submit(CParallelTaskGroup &group, CParallelTask *tasks, std::size_t nTasksIn)
+{
+    if (nTasksIn == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(group.mutex);
+        group.nRemaining += nTasksIn;
+    }
+
+    // Counted before they are published, a worker taking one of them right away must not make nQueued wrap.
+    // Meanwhile workers may find the queues empty for a moment and look again
+    nQueued += nTasksIn;
+
+    int nSelf = pCurrentExecutor == this ? nCurrentWorker : -1;
+    if (nSelf >= 0) {
+        Worker &worker = *workers[nSelf];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        for (std::size_t i = 0; i < nTasksIn; i++) {
+            tasks[i].group = &group;
+            worker.tasks.push_back(&tasks[i]);
+        }
+    } else {
+        std::size_t nWorker = nNextWorker++;
+        for (std::size_t i = 0; i < nTasksIn; i++) {
+            tasks[i].group = &group;
+            Worker &worker = *workers[nWorker++ % workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(&tasks[i]);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    if (nTasksIn == 1)
+        cond.notify_one();
+    else
+        cond.notify_all();
+}
+
+void CParallelExecutor::Wait(CParallelTaskGroup &group)
+{
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(group.mutex);
+            if (group.nRemaining == 0)
+                break;
+        }
+        // Tasks of the group are either queued or running, help with whatever is queued
+        CParallelTask *task = Take();
+        if (!task)
+            break;
+        Run(task);
+    }
+
+    std::unique_lock<std::mutex> lock(group.mutex);
+    group.cond.wait(lock, [&group] { return group.nRemaining == 0; });
+    if (group.error) {
+        std::exception_ptr error = group.error;
+        group.error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+ParallelExecutorStats CParallelExecutor::GetStats() const
+{
+    ParallelExecutorStats stats;
+    stats.nWorkers = workers.size();
+    stats.nQueued = nQueued.load();
+    stats.nTasks = nTasks.load();
+    stats.nSteals = nSteals.load();
+    return stats;
+}
+
+CParallelExecutor &GetParallelExecutor()
+{
+    std::lock_guard<std::mutex> lock(csExecutor);
+    if (!executor) {
+        unsigned int nCores = std::thread::hardware_concurrency();
+        executor.reset(new CParallelExecutor(nCores > 1 ? nCores - 1 : 1));
+    }
+    return *executor;
+}
+
+void StopParallelExecutor()
+{
+    std::lock_guard<std::mutex> lock(csExecutor);
+    executor.reset();
+}
+
+ParallelExecutorStats GetParallelExecutorStats()
+{
+    std::lock_guard<std::mutex> lock(csExecutor);
+    if (executor)
+        return executor->GetStats();
+    ParallelExecutorStats stats = ParallelExecutorStats();
+    return stats;
+}
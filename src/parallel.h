@@ -0,0 +1,171 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NIX_PARALLEL_H
+#define NIX_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CParallelTaskGroup;
+
+/** A range of work queued on the executor, run as pfn(ctx, begin, end) */
+struct CParallelTask
+{
+    void (*pfn)(void *ctx, std::size_t begin, std::size_t end);
+    void *ctx;
+    std::size_t begin;
+    std::size_t end;
+    CParallelTaskGroup *group;
+};
+
+/** Tasks a thread waits for together. Tasks and group belong to the waiting thread, nothing is allocated per task */
+class CParallelTaskGroup
+{
+private:
+    friend class CParallelExecutor;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::size_t nRemaining;
+    std::exception_ptr error;
+
+public:
+    CParallelTaskGroup() : nRemaining(0) {}
+
+    CParallelTaskGroup(const CParallelTaskGroup&) = delete;
+    CParallelTaskGroup& operator=(const CParallelTaskGroup&) = delete;
+};
+
+struct ParallelExecutorStats
+{
+    int nWorkers;
+    //! Tasks queued right now
+    std::size_t nQueued;
+    //! Tasks run since the start
+    uint64_t nTasks;
+    //! Tasks a thread took from the queue of another thread
+    uint64_t nSteals;
+};
+
+/**
+ * Work-stealing executor shared by the proof verifiers.
+ *
+ * Every worker thread has a queue of its own. A worker queues the tasks it submits on its own queue and takes
+ * the newest task from it. When its queue is empty it steals the oldest task of another one. Threads outside
+ * of the executor spread their tasks over the queues of the workers. A thread waiting for a group runs queued
+ * tasks until the tasks of the group are done, so the executor can be used from its own tasks and from
+ * threads of other pools, e.g. the script check threads, without running out of threads.
+ *
+ * The worker threads are started on first use and run until shutdown.
+ */
+class CParallelExecutor
+{
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<CParallelTask *> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    // Wakes up idle workers, nQueued is changed before it is notified
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool fShutdown;
+
+    std::atomic<std::size_t> nQueued;
+    std::atomic<uint64_t> nTasks;
+    std::atomic<uint64_t> nSteals;
+    std::atomic<std::size_t> nNextWorker;
+
+    void ThreadWorker(int nWorker);
+
+    // Take a task, from the queue of the calling worker first. NULL if all the queues are empty
+    CParallelTask *Take();
+
+    void Run(CParallelTask *task);
+
+public:
+    explicit CParallelExecutor(int nWorkers);
+    ~CParallelExecutor();
+
+    CParallelExecutor(const CParallelExecutor&) = delete;
+    CParallelExecutor& operator=(const CParallelExecutor&) = delete;
+
+    int GetWorkerCount() const { return workers.size(); }
+
+    //! Queue tasks of the group. The tasks must stay where they are until the group is waited for
+    void Submit(CParallelTaskGroup &group, CParallelTask *tasks, std::size_t nTasks);
+
+    //! Run queued tasks until the tasks of the group are done, rethrow the first exception one of them threw
+    void Wait(CParallelTaskGroup &group);
+
+    ParallelExecutorStats GetStats() const;
+};
+
+//! The executor of the process, started on first use with one worker less than there are cores
+CParallelExecutor &GetParallelExecutor();
+
+//! Stop the workers of the executor if it was started. Nothing may use it afterwards
+void StopParallelExecutor();
+
+ParallelExecutorStats GetParallelExecutorStats();
+
+/**
+ * Call func(i) for every i in [0, n) on the executor and wait for it. The range is cut into chunks of at least
+ * nMinChunk indexes, a few per thread, so a loop of many small steps costs a handful of queue operations
+ * instead of one per step. Exceptions thrown by func are rethrown once all the chunks are done.
+ */
+template <typename Func>
+void ParallelFor(std::size_t n, std::size_t nMinChunk, const Func &func)
+{
+    if (n == 0)
+        return;
+
+    CParallelExecutor &executor = GetParallelExecutor();
+    std::size_t nChunk = n / (4 * (std::size_t)(executor.GetWorkerCount() + 1));
+    if (nChunk < nMinChunk)
+        nChunk = nMinChunk;
+    if (nChunk < 1)
+        nChunk = 1;
+    if (nChunk >= n) {
+        for (std::size_t i = 0; i < n; i++)
+            func(i);
+        return;
+    }
+
+    std::vector<CParallelTask> tasks;
+    tasks.reserve((n + nChunk - 1) / nChunk);
+    for (std::size_t begin = 0; begin < n; begin += nChunk) {
+        CParallelTask task;
+        task.pfn = [](void *ctx, std::size_t b, std::size_t e) {
+            const Func &f = *static_cast<const Func *>(ctx);
+            for (std::size_t i = b; i < e; i++)
+                f(i);
+        };
+        task.ctx = const_cast<Func *>(&func);
+        task.begin = begin;
+        task.end = std::min(begin + nChunk, n);
+        tasks.push_back(task);
+    }
+
+    CParallelTaskGroup group;
+    executor.Submit(group, tasks.data(), tasks.size());
+    executor.Wait(group);
+}
+
+#endif // NIX_PARALLEL_H
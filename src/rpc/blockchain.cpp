@@ -26,6 +26,7 @@
 #include <hash.h>
 #include <validationinterface.h>
 #include <warnings.h>
+#include <zerocoin/zerocoin.h>
 
 #include <stdint.h>
 
@@ -1196,6 +1197,7 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"initialblockdownload\": xxxx, (bool) (debug information) estimate of whether this node is in Initial Block Download mode.\n"
             "  \"chainwork\": \"xxxx\"           (string) total amount of work in active chain, in hexadecimal\n"
             "  \"size_on_disk\": xxxxxx,       (numeric) the estimated size of the block and undo files on disk\n"
+            "  \"zerocoin_proofs_skipped\": xx, (numeric) Zerocoin spend proofs of the blocks connected since the start that were not verified because they are buried under -assumevalidprivacy\n"
             "  \"pruned\": xx,                 (boolean) if the blocks are subject to pruning\n"
             "  \"pruneheight\": xxxxxx,        (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"automatic_pruning\": xx,      (boolean) whether automatic pruning is enabled (only present if pruning is enabled)\n"
@@ -1245,6 +1247,7 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     obj.push_back(Pair("initialblockdownload",  IsInitialBlockDownload()));
     obj.push_back(Pair("chainwork",             chainActive.Tip()->nChainWork.GetHex()));
     obj.push_back(Pair("size_on_disk",          CalculateCurrentUsage()));
+    obj.push_back(Pair("zerocoin_proofs_skipped", GetSkippedZerocoinProofCount()));
     obj.push_back(Pair("pruned",                fPruneMode));
     if (fPruneMode) {
         CBlockIndex* block = chainActive.Tip();
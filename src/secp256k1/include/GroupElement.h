@@ -20,15 +20,15 @@ public:
 
   GroupElement();
 
-  ~GroupElement();
+  ~GroupElement() = default;
 
-  GroupElement(const GroupElement& other);
+  GroupElement(const GroupElement& other) = default;
 
   GroupElement(const char* x,const char* y,  int base = 10);
 
   GroupElement& set(const GroupElement& other);
 
-  GroupElement& operator=(const GroupElement& other);
+  GroupElement& operator=(const GroupElement& other) = default;
 
   // Operator for multiplying with a scalar number.
   GroupElement operator*(const Scalar& multiplier) const;
@@ -50,6 +50,13 @@ public:
 
   bool operator!=(const GroupElement&other) const;
 
+  // Brings the point to affine form (z = 1). Affine points compare, hash,
+  // serialize and feed MultiExponent without a field inversion.
+  GroupElement& normalize();
+
+  // Same as normalize() for many points, sharing a single field inversion.
+  static void normalize_all(std::vector<GroupElement>& points);
+
   bool isMember() const;
 
   bool isInfinity() const;
@@ -111,7 +118,12 @@ private:
     GroupElement(const void *g);
 
 private:
-    void *g_; // secp256k1_gej
+    // secp256k1_gej is kept inline, so temporaries and std::vector copies do
+    // not touch the heap. The size covers both field representations
+    // (including the VERIFY bookkeeping); GroupElement.cpp static_asserts it.
+    static constexpr std::size_t storage_size = 152;
+
+    alignas(8) unsigned char g_[storage_size]; // secp256k1_gej
 
 };
 
@@ -1,24 +1,41 @@
 #ifndef SECP_MULTIEXPONENT_H
 #define SECP_MULTIEXPONENT_H
 
+#include <cstddef>
 #include <vector>
 #include "GroupElement.h"
 #include "Scalar.h"
 
 namespace secp_primitives {
 
+// Computes sum(generators[i] * powers[i]). The points and scalars are not
+// copied, so they have to outlive the MultiExponent object.
 class MultiExponent final {
 public:
-    MultiExponent(const MultiExponent& other);
+    MultiExponent(const MultiExponent& other) = default;
     MultiExponent(const std::vector<GroupElement>& generators, const std::vector<Scalar>& powers);
-    ~MultiExponent();
+    MultiExponent(const GroupElement* generators, const Scalar* powers, std::size_t n);
+    ~MultiExponent() = default;
 
     GroupElement get_multiple();
 
+    // Precomputes window tables for a base that is multiplied over and over
+    // again, like the Sigma generators g and h. get_multiple() recognizes the
+    // base (and copies of it) afterwards and takes its multiple from the table
+    // instead of running it through Pippenger/Strauss.
+    static void precompute(const GroupElement& base);
+
+    // Sets how many threads get_multiple() may use. Large multiplications are
+    // split into point ranges that run on a shared worker pool, and the caller
+    // sums the partial results. 1 (the default) keeps all work on the calling
+    // thread.
+    static void set_thread_count(std::size_t n);
+    static std::size_t get_thread_count();
+
 private:
-    void  *sc_; // secp256k1_scalar[]
-    void  *pt_; // secp256k1_gej[]
-    int n_points;
+    const GroupElement* generators_;
+    const Scalar* powers_;
+    std::size_t n_points;
 };
 
 }// namespace secp_primitives
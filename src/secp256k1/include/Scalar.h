@@ -19,15 +19,15 @@ public:
     Scalar(uint64_t value);
 
     // Copy constructor
-    Scalar(const Scalar& other);
+    Scalar(const Scalar& other) = default;
 
     Scalar(const unsigned char* str);
 
-    ~Scalar();
+    ~Scalar() = default;
 
     Scalar& set(const Scalar& other);
 
-    Scalar& operator=(const Scalar& other);
+    Scalar& operator=(const Scalar& other) = default;
 
     Scalar& operator=(unsigned int i);
 
@@ -87,7 +87,7 @@ public:
     unsigned char* deserialize(unsigned char* buffer);
 
     std::string GetHex() const;
-    void SetHex(const std::string& str) const;
+    void SetHex(const std::string& str);
 
     // These functions are for READWRITE() in serialize.h
 
@@ -121,7 +121,11 @@ private:
     Scalar(const void *value);
 
 private:
-    void *value_; // secp256k1_scalar
+    // Both scalar representations (4x64 and 8x32) are 32 bytes; the limbs are
+    // kept inline so arithmetic temporaries do not allocate.
+    static constexpr size_t storage_size = 32;
+
+    alignas(8) unsigned char value_[storage_size]; // secp256k1_scalar
 
 };
 
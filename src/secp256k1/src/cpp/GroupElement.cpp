@@ -14,7 +14,6 @@
 
 #include <openssl/rand.h>
 
-#include <array>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -24,9 +23,17 @@
 static secp256k1_ecmult_context ctx;
 
 // Converts the value from secp256k1_gej to secp256k1_ge and returns.
+// Points that are already affine (deserialized or normalized ones) are
+// converted without a field inversion.
 static secp256k1_ge gej_to_ge(const secp256k1_gej &gej)
 {
     secp256k1_ge ge;
+    if (secp256k1_gej_is_affine_var(&gej)) {
+        secp256k1_ge_set_gej_affine(&ge, &gej);
+        secp256k1_fe_normalize_var(&ge.x);
+        secp256k1_fe_normalize_var(&ge.y);
+        return ge;
+    }
     secp256k1_gej j(gej);
     secp256k1_ge_set_gej(&ge, &j);
     return ge;
@@ -159,22 +166,18 @@ static void _negate (uint8_t(&num) [Len])
     }
 }
 
+static_assert(sizeof(secp256k1_gej) <= sizeof(GroupElement), "GroupElement storage is too small for secp256k1_gej");
+
 GroupElement::GroupElement()
-        : g_(new secp256k1_gej())
 {
     auto g = reinterpret_cast<secp256k1_gej *>(g_);
     secp256k1_gej_clear(g);
     g->infinity = 1;
 }
 
-GroupElement::GroupElement(const GroupElement& other)
-        : g_(new secp256k1_gej(*reinterpret_cast<secp256k1_gej *>(other.g_)))
-{
-}
-
 GroupElement::GroupElement(const void *g)
-        : g_(new secp256k1_gej(*reinterpret_cast<const secp256k1_gej *>(g)))
 {
+    *reinterpret_cast<secp256k1_gej *>(g_) = *reinterpret_cast<const secp256k1_gej *>(g);
 }
 
 static void _convertToFieldElement(secp256k1_fe *r, const char* str, int base) {
@@ -225,7 +228,6 @@ static void _convertToFieldElement(secp256k1_fe *r, const char* str, int base) {
 }
 
 GroupElement::GroupElement(const char* x,const char* y, int base)
-        : g_(new secp256k1_gej())
 {
     auto g = reinterpret_cast<secp256k1_gej *>(g_);
 
@@ -237,19 +239,9 @@ GroupElement::GroupElement(const char* x,const char* y, int base)
     secp256k1_gej_set_ge(g,&element);
 }
 
-GroupElement::~GroupElement()
-{
-    delete reinterpret_cast<secp256k1_gej *>(g_);
-}
-
-GroupElement& GroupElement::operator=(const GroupElement &other)
-{
-    return set(other);
-}
-
 GroupElement& GroupElement::set(const GroupElement &other)
 {
-    *reinterpret_cast<secp256k1_gej *>(g_) = *reinterpret_cast<secp256k1_gej *>(other.g_);
+    *reinterpret_cast<secp256k1_gej *>(g_) = *reinterpret_cast<const secp256k1_gej *>(other.g_);
     return *this;
 }
 
@@ -258,7 +250,7 @@ GroupElement GroupElement::operator*(const Scalar& multiplier) const
     secp256k1_gej result;
     secp256k1_scalar ng;
     secp256k1_scalar_set_int(&ng,0);
-    secp256k1_ecmult(&ctx,&result,reinterpret_cast<secp256k1_gej *>(g_), reinterpret_cast<const secp256k1_scalar *>(multiplier.get_value()),&ng);
+    secp256k1_ecmult(&ctx,&result,reinterpret_cast<const secp256k1_gej *>(g_), reinterpret_cast<const secp256k1_scalar *>(multiplier.get_value()),&ng);
     return &result;
 }
 
@@ -274,21 +266,21 @@ GroupElement& GroupElement::operator*=(const Scalar& multiplier)
 GroupElement GroupElement::operator+(const GroupElement &other) const
 {
     secp256k1_gej result_gej;
-    secp256k1_gej_add_var(&result_gej, reinterpret_cast<secp256k1_gej *>(g_), reinterpret_cast<secp256k1_gej *>(other.g_), NULL);
+    secp256k1_gej_add_var(&result_gej, reinterpret_cast<const secp256k1_gej *>(g_), reinterpret_cast<const secp256k1_gej *>(other.g_), NULL);
     return &result_gej;
 }
 
 GroupElement& GroupElement::operator+=(const GroupElement& other)
 {
     auto g = reinterpret_cast<secp256k1_gej *>(g_);
-    secp256k1_gej_add_var(g, g, reinterpret_cast<secp256k1_gej *>(other.g_), NULL);
+    secp256k1_gej_add_var(g, g, reinterpret_cast<const secp256k1_gej *>(other.g_), NULL);
     return *this;
 }
 
 GroupElement GroupElement::inverse() const
 {
     secp256k1_gej result_gej;
-    secp256k1_gej_neg(&result_gej,reinterpret_cast<secp256k1_gej *>(g_));
+    secp256k1_gej_neg(&result_gej,reinterpret_cast<const secp256k1_gej *>(g_));
     return &result_gej;
 }
 
@@ -300,8 +292,8 @@ void GroupElement::square()
 
 bool GroupElement::operator==(const  GroupElement& other) const
 {
-    auto g = reinterpret_cast<secp256k1_gej *>(g_);
-    auto og = reinterpret_cast<secp256k1_gej *>(other.g_);
+    auto g = reinterpret_cast<const secp256k1_gej *>(g_);
+    auto og = reinterpret_cast<const secp256k1_gej *>(other.g_);
 
     if(g->infinity && og->infinity)
         return true;
@@ -322,9 +314,48 @@ bool GroupElement::operator!=(const  GroupElement& other) const
     return !(*this == other);
 }
 
+GroupElement& GroupElement::normalize()
+{
+    auto g = reinterpret_cast<secp256k1_gej *>(g_);
+    if (g->infinity || secp256k1_gej_is_affine_var(g)) {
+        return *this;
+    }
+
+    secp256k1_ge ge;
+    secp256k1_ge_set_gej_var(&ge, g);
+    secp256k1_fe_normalize_var(&ge.x);
+    secp256k1_fe_normalize_var(&ge.y);
+    secp256k1_gej_set_ge(g, &ge);
+    return *this;
+}
+
+void GroupElement::normalize_all(std::vector<GroupElement>& points)
+{
+    std::vector<secp256k1_gej> jacobian;
+    std::vector<std::size_t> indexes;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        auto g = reinterpret_cast<const secp256k1_gej *>(points[i].g_);
+        if (!g->infinity && !secp256k1_gej_is_affine_var(g)) {
+            jacobian.push_back(*g);
+            indexes.push_back(i);
+        }
+    }
+    if (jacobian.empty()) {
+        return;
+    }
+
+    std::vector<secp256k1_ge> affine(jacobian.size());
+    secp256k1_ge_set_all_gej_var(affine.data(), jacobian.data(), jacobian.size(), NULL);
+    for (std::size_t i = 0; i < affine.size(); ++i) {
+        secp256k1_fe_normalize_var(&affine[i].x);
+        secp256k1_fe_normalize_var(&affine[i].y);
+        secp256k1_gej_set_ge(reinterpret_cast<secp256k1_gej *>(points[indexes[i]].g_), &affine[i]);
+    }
+}
+
 bool GroupElement::isMember() const
 {
-    secp256k1_ge v1 = gej_to_ge(*reinterpret_cast<secp256k1_gej *>(g_));
+    secp256k1_ge v1 = gej_to_ge(*reinterpret_cast<const secp256k1_gej *>(g_));
     if (secp256k1_ge_is_infinity(&v1)) {
         return true;
     }
@@ -388,7 +419,7 @@ GroupElement& GroupElement::generate(unsigned char* seed){
 }
 
 void GroupElement::sha256(unsigned char* result) const{
-    auto g = reinterpret_cast<secp256k1_gej *>(g_);
+    auto g = reinterpret_cast<const secp256k1_gej *>(g_);
     unsigned char buff[64];
     secp256k1_fe_get_b32(&buff[0], &g->x);
     secp256k1_fe_get_b32(&buff[32], &g->y);
@@ -447,7 +478,7 @@ std::string _convertToString(const unsigned char(&buffer) [Len], int base) {
 
 std::string GroupElement::tostring() const {
     int base = 10;
-    secp256k1_ge ge = gej_to_ge(*reinterpret_cast<secp256k1_gej *>(g_));
+    secp256k1_ge ge = gej_to_ge(*reinterpret_cast<const secp256k1_gej *>(g_));
 
     if (ge.infinity) {
     return std::string("O");
@@ -469,7 +500,7 @@ std::string GroupElement::tostring() const {
 
 std::string GroupElement::GetHex() const {
     int base = 16;
-    secp256k1_ge ge = gej_to_ge(*reinterpret_cast<secp256k1_gej *>(g_));
+    secp256k1_ge ge = gej_to_ge(*reinterpret_cast<const secp256k1_gej *>(g_));
 
     if (ge.infinity) {
         return std::string("O");
@@ -495,7 +526,7 @@ size_t GroupElement::memoryRequired() const  {
 
 
 unsigned char* GroupElement::serialize() const {
-    auto g = reinterpret_cast<secp256k1_gej *>(g_);
+    auto g = reinterpret_cast<const secp256k1_gej *>(g_);
     unsigned char* data = new unsigned char[ 2 * sizeof(secp256k1_fe)];
     memcpy(&data[0], &g->x.n[0], sizeof(secp256k1_fe));
     memcpy(&data[0] + sizeof(secp256k1_fe), &g->y.n[0], sizeof(secp256k1_fe));
@@ -503,7 +534,7 @@ unsigned char* GroupElement::serialize() const {
 }
 
 unsigned char* GroupElement::serialize(unsigned char* buffer) const {
-    secp256k1_ge value = gej_to_ge(*reinterpret_cast<secp256k1_gej *>(g_));
+    secp256k1_ge value = gej_to_ge(*reinterpret_cast<const secp256k1_gej *>(g_));
     secp256k1_fe x = value.x;
     secp256k1_fe y = value.y;
     secp256k1_fe_normalize(&x);
@@ -538,17 +569,24 @@ std::vector<unsigned char> GroupElement::getvch() const {
 
 std::size_t GroupElement::hash() const
 {
-    auto ge = gej_to_ge(*reinterpret_cast<secp256k1_gej *>(g_));
-    std::array<unsigned char, 32 * 2> coord;
-
+    auto ge = gej_to_ge(*reinterpret_cast<const secp256k1_gej *>(g_));
     if (ge.infinity) {
-        coord.fill(0);
-    } else {
-        secp256k1_fe_get_b32(&coord[0], &ge.x);
-        secp256k1_fe_get_b32(&coord[32], &ge.y);
+        return 0;
     }
 
-    return std::hash<std::string>()(std::string(coord.begin(), coord.end()));
+    // Mix the x coordinate (and the oddness of y) word by word, there is no
+    // need to build a string of the coordinates first.
+    unsigned char x[32];
+    secp256k1_fe_get_b32(x, &ge.x);
+
+    uint64_t result = 0x9e3779b97f4a7c15ULL ^ secp256k1_fe_is_odd(&ge.y);
+    for (int i = 0; i < 32; i += 8) {
+        uint64_t word;
+        memcpy(&word, &x[i], sizeof(word));
+        result = (result ^ word) * 0xff51afd7ed558ccdULL;
+        result ^= result >> 33;
+    }
+    return result;
 }
 
 const void* GroupElement::get_value() const {
@@ -12,73 +12,325 @@
 #include "scratch_impl.h"
 #include "ecmult_impl.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <string.h>
+
 
 typedef struct {
-    secp256k1_scalar *sc;
-    secp256k1_gej *pt;
-} ecmult_multi_data;
+    const secp256k1_scalar *sc;
+    const secp256k1_gej *pt;
+} ecmult_multi_point;
 
 int ecmult_multi_callback(secp256k1_scalar *sc, secp256k1_gej *pt, size_t idx, void *cbdata) {
-    ecmult_multi_data *data = (ecmult_multi_data*) cbdata;
-    *sc = data->sc[idx];
-    *pt = data->pt[idx];
+    const ecmult_multi_point *data = (const ecmult_multi_point*) cbdata;
+    *sc = *data[idx].sc;
+    *pt = *data[idx].pt;
     return 1;
 }
 
-namespace secp_primitives {
+// Number of 4 bit windows of a scalar, and the non-zero digits of a window.
+#define FIXED_BASE_WINDOWS 64
+#define FIXED_BASE_DIGITS 15
+// Upper bound on registered bases; Sigma needs 1 + n * m of them.
+#define FIXED_BASE_MAX 64
 
-MultiExponent::MultiExponent(const MultiExponent& other)
-        : sc_(new secp256k1_scalar[other.n_points])
-        , pt_(new secp256k1_gej[other.n_points])
-        , n_points(other.n_points)
-{
-    for(int i = 0; i < n_points; ++i)
-    {
-        (reinterpret_cast<secp256k1_scalar *>(sc_))[i] = (reinterpret_cast<secp256k1_scalar *>(other.sc_))[i];
-        (reinterpret_cast<secp256k1_gej *>(pt_))[i] = (reinterpret_cast<secp256k1_gej *>(other.pt_))[i];
+// Precomputed multiples of a fixed base, entry [i * FIXED_BASE_DIGITS + d - 1]
+// holds d * 16^i * base.
+typedef struct {
+    secp256k1_gej base;
+    secp256k1_ge_storage table[FIXED_BASE_WINDOWS * FIXED_BASE_DIGITS];
+} fixed_base;
+
+// Bases are only ever added, and are never freed. Lookups read the published
+// count and do not take the lock.
+static std::mutex fixed_bases_mutex;
+static const fixed_base *fixed_bases[FIXED_BASE_MAX];
+static std::atomic<size_t> fixed_bases_count(0);
+
+// The g term of secp256k1_ecmult_multi_var is never used, so the context has
+// no precomputed tables of g. It is initialized empty once, before first use.
+static const secp256k1_ecmult_context *get_ecmult_context() {
+    static const secp256k1_ecmult_context *ctx = [] {
+        static secp256k1_ecmult_context empty_ctx;
+        secp256k1_ecmult_context_init(&empty_ctx);
+        return &empty_ctx;
+    }();
+    return ctx;
+}
+
+static bool same_representation(const secp256k1_gej *a, const secp256k1_gej *b) {
+    return a->infinity == b->infinity
+        && memcmp(a->x.n, b->x.n, sizeof(a->x.n)) == 0
+        && memcmp(a->y.n, b->y.n, sizeof(a->y.n)) == 0
+        && memcmp(a->z.n, b->z.n, sizeof(a->z.n)) == 0;
+}
+
+static const fixed_base *find_fixed_base(const secp256k1_gej *pt, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (same_representation(pt, &fixed_bases[i]->base)) {
+            return fixed_bases[i];
+        }
     }
+    return NULL;
 }
 
-MultiExponent::MultiExponent(const std::vector<GroupElement>& generators, const std::vector<Scalar>& powers){
-    sc_ = new secp256k1_scalar[powers.size()];
-    pt_ = new secp256k1_gej[generators.size()];
-    n_points = generators.size();
-    for(int i = 0; i < n_points; ++i)
-    {
-        (reinterpret_cast<secp256k1_scalar *>(sc_))[i] = *reinterpret_cast<const secp256k1_scalar *>(powers[i].get_value());
-        (reinterpret_cast<secp256k1_gej *>(pt_))[i] = *reinterpret_cast<const secp256k1_gej *>(generators[i].get_value());
+static void fixed_base_multiply(secp256k1_gej *r, const fixed_base *base, const secp256k1_scalar *sc) {
+    unsigned char b32[32];
+    secp256k1_ge ge;
+
+    secp256k1_scalar_get_b32(b32, sc);
+    for (int i = 0; i < FIXED_BASE_WINDOWS; ++i) {
+        int digit = (b32[31 - i / 2] >> ((i & 1) * 4)) & 0x0f;
+        if (digit != 0) {
+            secp256k1_ge_from_storage(&ge, &base->table[i * FIXED_BASE_DIGITS + digit - 1]);
+            secp256k1_gej_add_ge_var(r, r, &ge, NULL);
+        }
     }
 }
 
-MultiExponent::~MultiExponent(){
-    delete []reinterpret_cast<secp256k1_scalar *>(sc_);
-    delete []reinterpret_cast<secp256k1_gej *>(pt_);
+// Keeps one scratch space per thread, which grows to the largest
+// multiplication the thread has done instead of being created per call.
+class thread_scratch {
+public:
+    ~thread_scratch() {
+        secp256k1_scratch_destroy(scratch);
+    }
+
+    secp256k1_scratch *get(size_t max_size) {
+        if (scratch == NULL) {
+            scratch = secp256k1_scratch_create(NULL, max_size);
+        } else if (scratch->max_size < max_size) {
+            scratch->max_size = max_size;
+        }
+        return scratch;
+    }
+
+private:
+    secp256k1_scratch *scratch = NULL;
+};
+
+static thread_local thread_scratch scratch_space;
+static thread_local std::vector<ecmult_multi_point> multi_points;
+
+// Don't split a multiplication into ranges smaller than this, Pippenger gets
+// less efficient per point the fewer points it has.
+#define MULTIEXP_MIN_POINTS_PER_THREAD 256
+
+static void multiexp_points(secp256k1_gej *r, const ecmult_multi_point *points, size_t n) {
+    size_t scratch_size;
+    if (n > ECMULT_PIPPENGER_THRESHOLD) {
+        int bucket_window = secp256k1_pippenger_bucket_window(n);
+        scratch_size = secp256k1_pippenger_scratch_size(n, bucket_window) + PIPPENGER_SCRATCH_OBJECTS*ALIGNMENT;
+    } else {
+        scratch_size = secp256k1_strauss_scratch_size(n) + STRAUSS_SCRATCH_OBJECTS*ALIGNMENT;
+    }
+
+    // The g scalar must stay NULL, the context has no tables for it
+    secp256k1_ecmult_multi_var(get_ecmult_context(), scratch_space.get(scratch_size), r, NULL, ecmult_multi_callback, (void *) points, n);
+}
+
+// One point range of a split multiplication.
+struct multiexp_range {
+    const ecmult_multi_point *points;
+    size_t n;
+    secp256k1_gej result;
+};
+
+// Tracks the ranges of one get_multiple() call that were handed to the pool.
+struct multiexp_batch {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining;
+};
+
+// Worker threads shared by all callers of get_multiple(). Queued ranges are
+// always run by a worker, so a caller can return once its batch is done.
+class multiexp_pool {
+public:
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return workers.size();
+    }
+
+    void resize(size_t n_workers) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (n_workers == workers.size()) {
+            return;
+        }
+
+        // Stop the current workers after they have drained the queue.
+        stop = true;
+        cond.notify_all();
+        std::vector<std::thread> old;
+        old.swap(workers);
+        lock.unlock();
+        for (std::thread& worker : old) {
+            worker.join();
+        }
+        lock.lock();
+
+        stop = false;
+        for (size_t i = 0; i < n_workers; ++i) {
+            workers.emplace_back(&multiexp_pool::work, this);
+        }
+    }
+
+    // Runs ranges[0] on the calling thread and the rest on the workers, then
+    // waits for all of them.
+    void run(multiexp_range *ranges, size_t n_ranges) {
+        multiexp_batch batch;
+        batch.remaining = n_ranges - 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 1; i < n_ranges; ++i) {
+                queue.emplace_back(&ranges[i], &batch);
+            }
+        }
+        cond.notify_all();
+
+        multiexp_points(&ranges[0].result, ranges[0].points, ranges[0].n);
+
+        std::unique_lock<std::mutex> lock(batch.mutex);
+        batch.done.wait(lock, [&batch]() { return batch.remaining == 0; });
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::pair<multiexp_range *, multiexp_batch *> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this]() { return stop || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                job = queue.front();
+                queue.pop_front();
+            }
+
+            multiexp_points(&job.first->result, job.first->points, job.first->n);
+
+            std::lock_guard<std::mutex> lock(job.second->mutex);
+            if (--job.second->remaining == 0) {
+                job.second->done.notify_one();
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::pair<multiexp_range *, multiexp_batch *>> queue;
+    std::vector<std::thread> workers;
+    bool stop = false;
+};
+
+// Never destroyed, so that worker threads still blocked on it at exit are harmless.
+static multiexp_pool *pool = new multiexp_pool();
+
+namespace secp_primitives {
+
+MultiExponent::MultiExponent(const std::vector<GroupElement>& generators, const std::vector<Scalar>& powers)
+        : generators_(generators.data())
+        , powers_(powers.data())
+        , n_points(generators.size())
+{
+}
+
+MultiExponent::MultiExponent(const GroupElement* generators, const Scalar* powers, std::size_t n)
+        : generators_(generators)
+        , powers_(powers)
+        , n_points(n)
+{
 }
 
 GroupElement MultiExponent::get_multiple(){
-    secp256k1_gej r;
+    secp256k1_gej r, fixed_sum;
+    secp256k1_gej_set_infinity(&fixed_sum);
+
+    size_t n_fixed = fixed_bases_count.load(std::memory_order_acquire);
+    multi_points.clear();
+    for (size_t i = 0; i < n_points; ++i) {
+        const secp256k1_gej *pt = reinterpret_cast<const secp256k1_gej *>(generators_[i].get_value());
+        const secp256k1_scalar *sc = reinterpret_cast<const secp256k1_scalar *>(powers_[i].get_value());
+        const fixed_base *base = find_fixed_base(pt, n_fixed);
+        if (base != NULL) {
+            fixed_base_multiply(&fixed_sum, base, sc);
+        } else {
+            multi_points.push_back({sc, pt});
+        }
+    }
 
-    ecmult_multi_data data;
-    data.sc = reinterpret_cast<secp256k1_scalar *>(sc_);
-    data.pt = reinterpret_cast<secp256k1_gej *>(pt_);
+    size_t n = multi_points.size();
+    size_t n_ranges = std::min(pool->size() + 1, n / MULTIEXP_MIN_POINTS_PER_THREAD);
+    if (n_ranges > 1) {
+        std::vector<multiexp_range> ranges(n_ranges);
+        size_t offset = 0;
+        for (size_t i = 0; i < n_ranges; ++i) {
+            ranges[i].points = multi_points.data() + offset;
+            ranges[i].n = n / n_ranges + (i < n % n_ranges ? 1 : 0);
+            offset += ranges[i].n;
+        }
+        pool->run(ranges.data(), n_ranges);
 
-    secp256k1_scratch *scratch;
-    if (n_points > ECMULT_PIPPENGER_THRESHOLD) {
-        int bucket_window = secp256k1_pippenger_bucket_window(n_points);
-        size_t scratch_size = secp256k1_pippenger_scratch_size(n_points, bucket_window);
-        scratch = secp256k1_scratch_create(NULL, scratch_size + PIPPENGER_SCRATCH_OBJECTS*ALIGNMENT);
+        secp256k1_gej_set_infinity(&r);
+        for (const multiexp_range& range : ranges) {
+            secp256k1_gej_add_var(&r, &r, &range.result, NULL);
+        }
     } else {
-        size_t scratch_size = secp256k1_strauss_scratch_size(n_points);
-        scratch = secp256k1_scratch_create(NULL, scratch_size + STRAUSS_SCRATCH_OBJECTS*ALIGNMENT);
+        multiexp_points(&r, multi_points.data(), n);
     }
+    secp256k1_gej_add_var(&r, &r, &fixed_sum, NULL);
+
+    return &r;
+}
 
-    secp256k1_ecmult_context ctx;
+void MultiExponent::set_thread_count(std::size_t n){
+    pool->resize(n > 0 ? n - 1 : 0);
+}
 
-    secp256k1_ecmult_multi_var(&ctx, scratch, &r, NULL, ecmult_multi_callback, &data, n_points);
+std::size_t MultiExponent::get_thread_count(){
+    return pool->size() + 1;
+}
 
-    secp256k1_scratch_destroy(scratch);
+void MultiExponent::precompute(const GroupElement& base){
+    const secp256k1_gej *pt = reinterpret_cast<const secp256k1_gej *>(base.get_value());
+    if (secp256k1_gej_is_infinity(pt)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(fixed_bases_mutex);
+    size_t count = fixed_bases_count.load(std::memory_order_relaxed);
+    if (count == FIXED_BASE_MAX || find_fixed_base(pt, count) != NULL) {
+        return;
+    }
+
+    fixed_base *entry = new fixed_base;
+    entry->base = *pt;
+
+    std::vector<secp256k1_gej> multiples(FIXED_BASE_WINDOWS * FIXED_BASE_DIGITS);
+    secp256k1_gej window = *pt;
+    for (int i = 0; i < FIXED_BASE_WINDOWS; ++i) {
+        secp256k1_gej *row = &multiples[i * FIXED_BASE_DIGITS];
+        row[0] = window;
+        for (int d = 1; d < FIXED_BASE_DIGITS; ++d) {
+            secp256k1_gej_add_var(&row[d], &row[d - 1], &window, NULL);
+        }
+        secp256k1_gej_add_var(&window, &row[FIXED_BASE_DIGITS - 1], &window, NULL);
+    }
+
+    std::vector<secp256k1_ge> affine(multiples.size());
+    secp256k1_ge_set_all_gej_var(affine.data(), multiples.data(), multiples.size(), NULL);
+    for (size_t i = 0; i < affine.size(); ++i) {
+        secp256k1_ge_to_storage(&entry->table[i], &affine[i]);
+    }
 
-    return  reinterpret_cast<secp256k1_scalar *>(&r);
+    fixed_bases[count] = entry;
+    fixed_bases_count.store(count + 1, std::memory_order_release);
 }
 
 }// namespace secp_primitives
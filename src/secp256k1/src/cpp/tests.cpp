@@ -12,6 +12,7 @@
 #ifdef ENABLE_OPENSSL_TESTS
 #include "include/GroupElement.h"
 #include "include/Scalar.h"
+#include "include/MultiExponent.h"
 #endif
 
 int main(int argc, char* argv[])
@@ -99,6 +100,20 @@ int main(int argc, char* argv[])
     // test scalar infinite loop bugs on GCC 8
     secp_primitives::Scalar scalar;
     scalar.randomize();
+
+    // multiples taken from the precomputed tables must match generic multiplication
+    secp_primitives::GroupElement base, other;
+    base.randomize();
+    other.randomize();
+    secp_primitives::MultiExponent::precompute(base);
+
+    std::vector<secp_primitives::GroupElement> points = {base, other, base};
+    std::vector<secp_primitives::Scalar> exps = {scalar, scalar, secp_primitives::Scalar(uint64_t(1)).negate()};
+    secp_primitives::GroupElement expected = base * exps[0] + other * exps[1] + base * exps[2];
+    if (secp_primitives::MultiExponent(points, exps).get_multiple() != expected) {
+        std::cout << "precomputed multiexponentiation mismatch" << std::endl;
+        return EXIT_FAILURE;
+    }
 #endif
 
     return EXIT_SUCCESS;
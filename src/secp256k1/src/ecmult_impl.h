@@ -845,7 +845,12 @@ static int secp256k1_ecmult_pippenger_batch(const secp256k1_ecmult_context *ctx,
             secp256k1_scratch_deallocate_frame(scratch);
             return 0;
         }
-        secp256k1_ge_set_gej(&points[idx], &point);
+        /* Affine inputs, such as deserialized coins, don't need an inversion */
+        if (secp256k1_gej_is_affine_var(&point)) {
+            secp256k1_ge_set_gej_affine(&points[idx], &point);
+        } else {
+            secp256k1_ge_set_gej(&points[idx], &point);
+        }
         idx++;
 #ifdef USE_ENDOMORPHISM
         secp256k1_ecmult_endo_split(&scalars[idx - 1], &scalars[idx], &points[idx - 1], &points[idx]);
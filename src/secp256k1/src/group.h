@@ -85,6 +85,12 @@ static void secp256k1_gej_set_infinity(secp256k1_gej *r);
 /** Set a group element (jacobian) equal to another which is given in affine coordinates. */
 static void secp256k1_gej_set_ge(secp256k1_gej *r, const secp256k1_ge *a);
 
+/** Set a group element equal to a jacobian one whose z coordinate is known to be one, without an inversion. */
+static void secp256k1_ge_set_gej_affine(secp256k1_ge *r, const secp256k1_gej *a);
+
+/** Check whether a jacobian group element has z = 1, i.e. can be used as an affine point directly. */
+static int secp256k1_gej_is_affine_var(const secp256k1_gej *a);
+
 /** Compare the X coordinate of a group element (jacobian). */
 static int secp256k1_gej_eq_x_var(const secp256k1_fe *x, const secp256k1_gej *a);
 
@@ -110,6 +110,17 @@ static void secp256k1_ge_set_gej(secp256k1_ge *r, secp256k1_gej *a) {
     r->y = a->y;
 }
 
+static void secp256k1_ge_set_gej_affine(secp256k1_ge *r, const secp256k1_gej *a) {
+    r->infinity = a->infinity;
+    r->x = a->x;
+    r->y = a->y;
+}
+
+static int secp256k1_gej_is_affine_var(const secp256k1_gej *a) {
+    static const secp256k1_fe one = SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 1);
+    return !a->infinity && secp256k1_fe_equal_var(&one, &a->z);
+}
+
 static void secp256k1_ge_set_gej_var(secp256k1_ge *r, secp256k1_gej *a) {
     secp256k1_fe z2, z3;
     r->infinity = a->infinity;
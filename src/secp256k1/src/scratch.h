@@ -15,6 +15,9 @@ typedef struct secp256k1_scratch_space_struct {
     void *data[SECP256K1_SCRATCH_MAX_FRAMES];
     size_t offset[SECP256K1_SCRATCH_MAX_FRAMES];
     size_t frame_size[SECP256K1_SCRATCH_MAX_FRAMES];
+    /* Frame buffers are kept after the frame is deallocated, so that a long
+     * lived scratch space does not call malloc on every use */
+    size_t capacity[SECP256K1_SCRATCH_MAX_FRAMES];
     size_t frame;
     size_t max_size;
     const secp256k1_callback* error_callback;
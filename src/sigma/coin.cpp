@@ -1,6 +1,8 @@
 #include <sigma/coin.h>
 #include <util.h>
 #include <amount.h>
+#include <hash.h>
+#include <random.h>
 
 #include <openssl/rand.h>
 #include <sstream>
@@ -162,6 +164,9 @@ PublicCoin::PublicCoin(const GroupElement& coin, const CoinDenomination d)
     : value(coin)
     , denomination(d)
 {
+    // Keep coins affine, so that hashing and comparing them or using them in
+    // an anonymity set needs no field inversion. Deserialized coins already are.
+    value.normalize();
 }
 
 const GroupElement& PublicCoin::getValue() const{
@@ -298,30 +303,38 @@ Scalar PrivateCoin::serialNumberFromSerializedPublicKey(
     return Scalar(hash);
 }
 
-std::size_t CScalarHash::operator ()(const Scalar& bn) const noexcept {
-    vector<unsigned char> bnData(bn.memoryRequired());
-    bn.serialize(&bnData[0]);
+// Salt shared by all Sigma hash tables of the process, so that the (cheap)
+// SipHash of a key can't be aimed at a single bucket by peers.
+static const std::pair<uint64_t, uint64_t>& GetHashSalt() {
+    static const std::pair<uint64_t, uint64_t> salt(
+        GetRand(std::numeric_limits<uint64_t>::max()),
+        GetRand(std::numeric_limits<uint64_t>::max()));
+    return salt;
+}
 
-    unsigned char hash[CSHA256::OUTPUT_SIZE];
-    CSHA256().Write(&bnData[0], bnData.size()).Finalize(hash);
+std::size_t CScalarHash::operator ()(const Scalar& bn) const noexcept {
+    uint256 data;
+    bn.serialize(data.begin());
 
-    // take the first bytes of "hash".
-    std::size_t result;
-    std::memcpy(&result, hash, sizeof(std::size_t));
-    return result;
+    const std::pair<uint64_t, uint64_t>& salt = GetHashSalt();
+    return SipHashUint256(salt.first, salt.second, data);
 }
 
 std::size_t CPublicCoinHash::operator ()(const PublicCoin& coin) const noexcept {
-    vector<unsigned char> bnData(coin.getValue().memoryRequired());
-    coin.getValue().serialize(&bnData[0]);
+    // x coordinate followed by the oddness of y and the infinity flag
+    unsigned char buffer[GroupElement::serialize_size];
+    coin.getValue().serialize(buffer);
 
-    unsigned char hash[CSHA256::OUTPUT_SIZE];
-    CSHA256().Write(&bnData[0], bnData.size()).Finalize(hash);
+    uint256 x;
+    std::memcpy(x.begin(), buffer, 32);
+
+    const std::pair<uint64_t, uint64_t>& salt = GetHashSalt();
+    return SipHashUint256Extra(salt.first, salt.second, x, (uint32_t(buffer[32]) << 8) | buffer[33]);
+}
 
-    // take the first bytes of "hash".
-    std::size_t result;
-    std::memcpy(&result, hash, sizeof(std::size_t));
-    return result;
+std::size_t CUint256Hash::operator ()(const uint256& hash) const noexcept {
+    const std::pair<uint64_t, uint64_t>& salt = GetHashSalt();
+    return SipHashUint256(salt.first, salt.second, hash);
 }
 
 } // namespace sigma
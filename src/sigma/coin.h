@@ -8,6 +8,7 @@
 #include <libzerocoin/Zerocoin.h>
 
 #include <cinttypes>
+#include <memory>
 
 namespace sigma {
 
@@ -85,6 +86,35 @@ private:
     CoinDenomination denomination;
 };
 
+// Anonymity set stored as an array of coin values with the newest coin last. Spend proofs index the
+// set newest coin first, so coin i of the set is coins[size - 1 - i], and the anonymity set of an
+// earlier block is a prefix of the array. The view does not own the coins, but it may share the
+// ownership of their storage, which then stays alive as long as the view or a copy of it.
+class AnonymitySetView {
+public:
+    AnonymitySetView(): coins(nullptr), nCoins(0) {}
+    AnonymitySetView(const GroupElement* coins, std::size_t nCoins): coins(coins), nCoins(nCoins) {}
+    AnonymitySetView(const GroupElement* coins, std::size_t nCoins, std::shared_ptr<const void> storage):
+        coins(coins), nCoins(nCoins), storage(std::move(storage)) {}
+
+    // Coin i in the order spend proofs use
+    const GroupElement& operator[](std::size_t i) const { return coins[nCoins - 1 - i]; }
+
+    std::size_t size() const { return nCoins; }
+    bool empty() const { return nCoins == 0; }
+
+    // The coins in storage order, newest last
+    const GroupElement* data() const { return coins; }
+
+    // The set made of the oldest nSize coins
+    AnonymitySetView prefix(std::size_t nSize) const { return AnonymitySetView(coins, std::min(nSize, nCoins), storage); }
+
+private:
+    const GroupElement* coins;
+    std::size_t nCoins;
+    std::shared_ptr<const void> storage;
+};
+
 class PrivateCoin {
 public:
     template<typename Stream>
@@ -158,6 +188,11 @@ struct CPublicCoinHash {
     std::size_t operator()(const PublicCoin& coin) const noexcept;
 };
 
+// Custom hash for the uint256 hashes of coin values and serials.
+struct CUint256Hash {
+    std::size_t operator()(const uint256& hash) const noexcept;
+};
+
 }// namespace sigma
 
 namespace std {
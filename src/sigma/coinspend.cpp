@@ -3,6 +3,15 @@
 
 namespace sigma {
 
+// Values of the coins in the storage order of AnonymitySetView, newest coin last
+static std::vector<GroupElement> CoinValuesNewestLast(const std::vector<PublicCoin>& anonymity_set) {
+    std::vector<GroupElement> values;
+    values.reserve(anonymity_set.size());
+    for (auto it = anonymity_set.rbegin(); it != anonymity_set.rend(); ++it)
+        values.emplace_back(it->getValue());
+    return values;
+}
+
 CoinSpend::CoinSpend(
     const Params* p,
     const PrivateCoin& coin,
@@ -18,6 +27,31 @@ CoinSpend::CoinSpend(
     ecdsaPubkey(33, 0),
     sigmaProof(p)
 {
+    std::vector<GroupElement> values = CoinValuesNewestLast(anonymity_set);
+    generateProof(coin, AnonymitySetView(values.data(), values.size()), fPadding);
+    updateMetaData(coin, m);
+}
+
+CoinSpend::CoinSpend(
+    const Params* p,
+    const PrivateCoin& coin,
+    const AnonymitySetView& anonymity_set,
+    const SpendMetaData& m,
+    bool fPadding)
+    :
+    params(p),
+    denomination(coin.getPublicCoin().getDenomination()),
+    accumulatorBlockHash(m.blockHash),
+    coinSerialNumber(coin.getSerialNumber()),
+    ecdsaSignature(64, 0),
+    ecdsaPubkey(33, 0),
+    sigmaProof(p)
+{
+    generateProof(coin, anonymity_set, fPadding);
+    updateMetaData(coin, m);
+}
+
+void CoinSpend::generateProof(const PrivateCoin& coin, const AnonymitySetView& anonymity_set, bool fPadding) {
     if (!HasValidSerial()) {
         throw ZerocoinException("Invalid serial # range");
     }
@@ -34,20 +68,20 @@ CoinSpend::CoinSpend(
     bool indexFound = false;
 
     for (std::size_t j = 0; j < anonymity_set.size(); ++j) {
-        if(anonymity_set[j] == coin.getPublicCoin()){
+        if(anonymity_set[j] == coin.getPublicCoin().getValue()){
             coinIndex = j;
             indexFound = true;
         }
 
-        C_.emplace_back(anonymity_set[j].getValue() + gs);
+        C_.emplace_back(anonymity_set[j] + gs);
     }
+    // C_ is multiplied m times by the prover, convert it to affine form once.
+    GroupElement::normalize_all(C_);
 
     if(!indexFound)
         throw ZerocoinException("No such coin in this anonymity set");
 
     sigmaProver.proof(C_, coinIndex, coin.getRandomness(), fPadding, sigmaProof);
-
-    updateMetaData(coin, m);
 }
 
 void CoinSpend::updateMetaData(const PrivateCoin& coin, const SpendMetaData& m){
@@ -100,14 +134,24 @@ bool CoinSpend::Verify(
         const std::vector<PublicCoin>& anonymity_set,
         const SpendMetaData& m,
         bool fPadding) const {
-    SigmaPlusVerifier<Scalar, GroupElement> sigmaVerifier(params->get_g(), params->get_h(), params->get_n(), params->get_m());
-    //compute inverse of g^s
-    GroupElement gs = (params->get_g() * coinSerialNumber).inverse();
-    std::vector<GroupElement> C_;
-    C_.reserve(anonymity_set.size());
-    for(std::size_t j = 0; j < anonymity_set.size(); ++j)
-        C_.emplace_back(anonymity_set[j].getValue() + gs);
+    std::vector<GroupElement> values = CoinValuesNewestLast(anonymity_set);
+    return Verify(AnonymitySetView(values.data(), values.size()), m, fPadding);
+}
+
+bool CoinSpend::Verify(
+        const AnonymitySetView& anonymity_set,
+        const SpendMetaData& m,
+        bool fPadding) const {
+    if (!HasValidSignature(m)) {
+        return false;
+    }
+
+    // Now verify the sigma proof itself. A batch of one folds g^s into the equation instead of
+    // subtracting it from every coin, so the affine coins go to the multi-exponentiation as they are.
+    return BatchVerify(params, anonymity_set, {this}, {anonymity_set.size()}, {fPadding});
+}
 
+bool CoinSpend::HasValidSignature(const SpendMetaData& m) const {
     uint256 metahash = signatureHash(m);
 
     // Verify ecdsa_signature, to make sure someone did not change the output of transaction.
@@ -138,11 +182,42 @@ bool CoinSpend::Verify(
         return false;
     }
 
-    // Now verify the sigma proof itself.
-    return sigmaVerifier.verify(C_, sigmaProof, fPadding);
+    return true;
+}
+
+bool CoinSpend::BatchVerify(
+        const Params* p,
+        const std::vector<PublicCoin>& anonymity_set,
+        const std::vector<const CoinSpend*>& spends,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding) {
+    // The last coins of anonymity_set are the first ones of the view
+    std::vector<GroupElement> values = CoinValuesNewestLast(anonymity_set);
+    return BatchVerify(p, AnonymitySetView(values.data(), values.size()), spends, setSizes, fPadding);
+}
+
+bool CoinSpend::BatchVerify(
+        const Params* p,
+        const AnonymitySetView& anonymity_set,
+        const std::vector<const CoinSpend*>& spends,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding) {
+    SigmaPlusVerifier<Scalar, GroupElement> sigmaVerifier(p->get_g(), p->get_h(), p->get_n(), p->get_m());
+
+    std::vector<Scalar> serials;
+    std::vector<SigmaPlusProof<Scalar, GroupElement>> proofs;
+    serials.reserve(spends.size());
+    proofs.reserve(spends.size());
+    for (const CoinSpend* spend : spends) {
+        serials.emplace_back(spend->coinSerialNumber);
+        proofs.emplace_back(spend->sigmaProof);
+    }
+
+    // Serials are folded into the verification equation, so the coins are taken as they are
+    return sigmaVerifier.batch_verify(anonymity_set.data(), anonymity_set.size(), serials, setSizes, fPadding, proofs);
 }
 
-const Scalar& CoinSpend::getCoinSerialNumber() {
+const Scalar& CoinSpend::getCoinSerialNumber() const {
     return this->coinSerialNumber;
 }
 
@@ -28,9 +28,15 @@ public:
               const SpendMetaData& m,
               bool fPadding);
 
+    CoinSpend(const Params* p,
+              const PrivateCoin& coin,
+              const AnonymitySetView& anonymity_set,
+              const SpendMetaData& m,
+              bool fPadding);
+
     void updateMetaData(const PrivateCoin& coin, const SpendMetaData& m);
 
-    const Scalar& getCoinSerialNumber();
+    const Scalar& getCoinSerialNumber() const;
 
     CoinDenomination getDenomination() const;
 
@@ -48,9 +54,35 @@ public:
         return accumulatorBlockHash;
     }
 
+    const SigmaPlusProof<Scalar, GroupElement>& getProof() const {
+        return sigmaProof;
+    }
+
     bool HasValidSerial() const;
 
     bool Verify(const std::vector<PublicCoin>& anonymity_set, const SpendMetaData &m, bool fPadding) const;
+    bool Verify(const AnonymitySetView& anonymity_set, const SpendMetaData &m, bool fPadding) const;
+
+    // Checks the ecdsa signature over the metadata and that it matches the serial number.
+    // Together with BatchVerify it gives the same result as Verify.
+    bool HasValidSignature(const SpendMetaData &m) const;
+
+    // Verifies sigma proofs of several spends of one coin group at once. Spend i was made over
+    // the last setSizes[i] coins of anonymity_set. Signatures are not checked here.
+    static bool BatchVerify(
+        const Params* p,
+        const std::vector<PublicCoin>& anonymity_set,
+        const std::vector<const CoinSpend*>& spends,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding);
+
+    // Same as above, spend i was made over anonymity_set.prefix(setSizes[i]).
+    static bool BatchVerify(
+        const Params* p,
+        const AnonymitySetView& anonymity_set,
+        const std::vector<const CoinSpend*>& spends,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding);
 
     ADD_SERIALIZE_METHODS;
     template <typename Stream, typename Operation>
@@ -74,6 +106,9 @@ public:
     
     uint256 signatureHash(const SpendMetaData& m) const;
 
+private:
+    void generateProof(const PrivateCoin& coin, const AnonymitySetView& anonymity_set, bool fPadding);
+
 private:
     const Params* params;
     unsigned int version = 0;
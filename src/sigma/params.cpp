@@ -35,6 +35,11 @@ Params::Params(const GroupElement& g, int n, int m) :
         h_[i - 1].sha256(buff);
         h_[i].generate(buff);
     }
+
+    // Every commitment is taken over g and h, so precompute their multiples once.
+    secp_primitives::MultiExponent::precompute(g_);
+    for (const GroupElement& h : h_)
+        secp_primitives::MultiExponent::precompute(h);
 }
 
 Params::~Params(){
@@ -30,6 +30,14 @@ public:
 
     static void new_factor(Exponent x, Exponent a, std::vector<Exponent>& coefficients);
 
+    // Computes f_i = \prod_j f[j * n + i_j] for all i < count, where i_j are the n-ary digits of i.
+    static void compute_fs(const std::vector<Exponent>& f, uint64_t n, uint64_t m, std::size_t count, std::vector<Exponent>& f_i_out);
+
+    // Computes coefficients of p_i(x) = \prod_j (sigma[j * n + i_j] x + a[j * n + i_j]) for all i < count.
+    // Coefficient k of p_i goes to p_k_i_out[k * N + i], so that every coefficient is a contiguous row.
+    static void compute_p_polynomials(const std::vector<Exponent>& sigma, const std::vector<Exponent>& a,
+            uint64_t n, uint64_t m, std::size_t N, std::size_t count, std::vector<Exponent>& p_k_i_out);
+
     };
 
 } // namespace sigma
@@ -9,7 +9,7 @@ void SigmaPrimitives<Exponent, GroupElement>::commit(const GroupElement& g,
         const Exponent& r,
         GroupElement& result_out)  {
     secp_primitives::MultiExponent mult(h, exp);
-    result_out += g * r + mult.get_multiple();
+    result_out += secp_primitives::MultiExponent(&g, &r, 1).get_multiple() + mult.get_multiple();
 }
 
 template<class Exponent, class GroupElement>
@@ -18,7 +18,11 @@ GroupElement SigmaPrimitives<Exponent, GroupElement>::commit(
         const Exponent m,
         const GroupElement h,
         const Exponent r){
-    return g * m + h * r;
+    // Goes through MultiExponent so that the precomputed tables of the Sigma
+    // generators are used.
+    const GroupElement points[2] = {g, h};
+    const Exponent exps[2] = {m, r};
+    return secp_primitives::MultiExponent(points, exps, 2).get_multiple();
 }
 
 template<class Exponent, class GroupElement>
@@ -99,4 +103,69 @@ void SigmaPrimitives<Exponent, GroupElement>::new_factor(
     coefficients[0] *= a;
 }
 
+/*
+ * Both functions below build the products digit by digit, starting from the most significant one. After
+ * digit j is processed, entry r holds the product over digits j..m-1 of the indices i with i / n^j = r.
+ * Entry r of the next level is derived from entry r / n of the previous one, so the entries are
+ * computed in place from the highest index down, and every entry costs one multiplication.
+ */
+template<class Exponent, class GroupElement>
+void SigmaPrimitives<Exponent, GroupElement>::compute_fs(
+        const std::vector<Exponent>& f,
+        uint64_t n,
+        uint64_t m,
+        std::size_t count,
+        std::vector<Exponent>& f_i_out) {
+    f_i_out.resize(count);
+
+    // Number of entries needed at each level, level_size[j] = ceil(count / n^j)
+    std::vector<std::size_t> level_size(m + 1);
+    level_size[0] = count;
+    for (uint64_t j = 1; j <= m; ++j)
+        level_size[j] = (level_size[j - 1] + n - 1) / n;
+
+    for (std::size_t r = 0; r < level_size[m]; ++r)
+        f_i_out[r] = Exponent(uint64_t(1));
+
+    for (uint64_t j = m; j-- > 0; ) {
+        const Exponent* f_j = &f[j * n];
+        for (std::size_t r = level_size[j]; r-- > 0; )
+            f_i_out[r] = f_j[r % n] * f_i_out[r / n];
+    }
+}
+
+template<class Exponent, class GroupElement>
+void SigmaPrimitives<Exponent, GroupElement>::compute_p_polynomials(
+        const std::vector<Exponent>& sigma,
+        const std::vector<Exponent>& a,
+        uint64_t n,
+        uint64_t m,
+        std::size_t N,
+        std::size_t count,
+        std::vector<Exponent>& p_k_i_out) {
+    p_k_i_out.resize((m + 1) * N);
+
+    std::vector<std::size_t> level_size(m + 1);
+    level_size[0] = count;
+    for (uint64_t j = 1; j <= m; ++j)
+        level_size[j] = (level_size[j - 1] + n - 1) / n;
+
+    for (std::size_t r = 0; r < level_size[m]; ++r)
+        p_k_i_out[r] = Exponent(uint64_t(1));
+
+    // Multiply every polynomial by the linear factor of digit j, its degree grows from m - j - 1 to m - j
+    for (uint64_t j = m; j-- > 0; ) {
+        uint64_t degree = m - j;
+        for (std::size_t r = level_size[j]; r-- > 0; ) {
+            const Exponent& x = sigma[j * n + r % n];
+            const Exponent& c = a[j * n + r % n];
+            std::size_t parent = r / n;
+            p_k_i_out[degree * N + r] = x * p_k_i_out[(degree - 1) * N + parent];
+            for (uint64_t k = degree - 1; k >= 1; --k)
+                p_k_i_out[k * N + r] = c * p_k_i_out[k * N + parent] + x * p_k_i_out[(k - 1) * N + parent];
+            p_k_i_out[r] = c * p_k_i_out[parent];
+        }
+    }
+}
+
 } // namespace sigma
@@ -45,21 +45,13 @@ void SigmaPlusProver<Exponent, GroupElement>::proof(
 
     Exponent x = r1prover.x_;
 
-    // Compute coefficients of Polynomials P_I(x), for all I from [0..N].
+    // Compute coefficients of Polynomials P_I(x), for all I from [0..N]. Coefficient k of P_I is
+    // stored in P_k_i[k * N + I].
     std::size_t N = setSize;
-    std::vector <std::vector<Exponent>> P_i_k;
-    P_i_k.resize(N);
+    std::vector<Exponent> P_k_i;
 
     // last polynomial is special case if fPadding is true
-    for (std::size_t i = 0; i < (fPadding ? N-1 : N); ++i) {
-        std::vector<Exponent>& coefficients = P_i_k[i];
-        std::vector<uint64_t> I = SigmaPrimitives<Exponent, GroupElement>::convert_to_nal(i, n_, m_);
-        coefficients.push_back(a[I[0]]);
-        coefficients.push_back(sigma[I[0]]);
-        for (int j = 1; j < m_; ++j) {
-            SigmaPrimitives<Exponent, GroupElement>::new_factor(sigma[j * n_ + I[j]], a[j * n_ + I[j]], coefficients);
-        }
-    }
+    SigmaPrimitives<Exponent, GroupElement>::compute_p_polynomials(sigma, a, n_, m_, N, fPadding ? N-1 : N, P_k_i);
 
     if (fPadding) {
         /*
@@ -109,19 +101,15 @@ void SigmaPlusProver<Exponent, GroupElement>::proof(
                 p_i_sum[j + k] += polynomial[k];
         }
 
-        P_i_k[N-1] = p_i_sum;
+        for (int k = 0; k <= m_; ++k)
+            P_k_i[k * N + N - 1] = p_i_sum[k];
     }
 
     //computing G_k`s;
     std::vector <GroupElement> Gk;
     Gk.reserve(m_);
     for (int k = 0; k < m_; ++k) {
-        std::vector <Exponent> P_i;
-        P_i.reserve(N);
-        for (size_t i = 0; i < N; ++i) {
-            P_i.emplace_back(P_i_k[i][k]);
-        }
-        secp_primitives::MultiExponent mult(commits, P_i);
+        secp_primitives::MultiExponent mult(commits.data(), &P_k_i[k * N], N);
         GroupElement c_k = mult.get_multiple();
         c_k += SigmaPrimitives<Exponent, GroupElement>::commit(g_, Exponent(uint64_t(0)), h_[0], Pk[k]);
         Gk.emplace_back(c_k);
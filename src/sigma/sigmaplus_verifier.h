@@ -5,6 +5,7 @@
 #include <sigma/sigmaplus_proof.h>
 #include <sigma/sigma_primitives.h>
 #include <secp256k1/include/MultiExponent.h>
+#include <parallel.h>
 #include <util.h>
 
 namespace sigma {
@@ -20,6 +21,34 @@ public:
                 const SigmaPlusProof<Exponent, GroupElement>& proof,
                 bool fPadding) const;
 
+    // Verifies several proofs made over one anonymity set in a single multi-exponentiation.
+    // Proof j is checked against the last setSizes[j] elements of 'commits', each of them
+    // shifted by -serials[j] * g. All proofs are combined with random weights, so a 'false'
+    // result only says that at least one of them is invalid.
+    bool batch_verify(const std::vector<GroupElement>& commits,
+                      const std::vector<Exponent>& serials,
+                      const std::vector<std::size_t>& setSizes,
+                      const std::vector<bool>& fPadding,
+                      const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs) const;
+
+    // Same as above for N commitments stored newest last, the way AnonymitySetView keeps them.
+    // Proof j is checked against the first setSizes[j] of them, which are not copied.
+    bool batch_verify(const GroupElement* commits,
+                      std::size_t N,
+                      const std::vector<Exponent>& serials,
+                      const std::vector<std::size_t>& setSizes,
+                      const std::vector<bool>& fPadding,
+                      const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs) const;
+
+private:
+    // Runs all the checks which don't depend on the anonymity set itself and computes
+    // the challenge x and the f_i coefficients for an anonymity set of size N.
+    bool prepare(std::size_t N,
+                 const SigmaPlusProof<Exponent, GroupElement>& proof,
+                 bool fPadding,
+                 Exponent& x,
+                 std::vector<Exponent>& f_i_) const;
+
 private:
     GroupElement g_;
     std::vector<GroupElement> h_;
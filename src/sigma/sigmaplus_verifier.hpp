@@ -19,6 +19,140 @@ bool  SigmaPlusVerifier<Exponent, GroupElement>::verify(
         const SigmaPlusProof<Exponent, GroupElement>& proof,
         bool fPadding) const {
 
+    Exponent x;
+    std::vector<Exponent> f_i_;
+    if (!prepare(commits.size(), proof, fPadding, x, f_i_))
+        return false;
+
+    const std::vector <GroupElement>& Gk = proof.Gk_;
+    secp_primitives::MultiExponent mult(commits, f_i_);
+    GroupElement t1 = mult.get_multiple();
+    GroupElement t2;
+    Exponent x_k(uint64_t(1));
+    for(int k = 0; k < m; ++k){
+        t2 += (Gk[k] * (x_k.negate()));
+        x_k *= x;
+    }
+
+    GroupElement left(t1 + t2);
+    if(left != SigmaPrimitives<Exponent, GroupElement>::commit(g_, Exponent(uint64_t(0)), h_[0], proof.z_))
+        return false;
+
+    return true;
+}
+
+template<class Exponent, class GroupElement>
+bool SigmaPlusVerifier<Exponent, GroupElement>::batch_verify(
+        const std::vector<GroupElement>& commits,
+        const std::vector<Exponent>& serials,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding,
+        const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs) const {
+    std::vector<GroupElement> newestLast(commits.rbegin(), commits.rend());
+    return batch_verify(newestLast.data(), newestLast.size(), serials, setSizes, fPadding, proofs);
+}
+
+template<class Exponent, class GroupElement>
+bool SigmaPlusVerifier<Exponent, GroupElement>::batch_verify(
+        const GroupElement* commits,
+        std::size_t N,
+        const std::vector<Exponent>& serials,
+        const std::vector<std::size_t>& setSizes,
+        const std::vector<bool>& fPadding,
+        const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs) const {
+    std::size_t M = proofs.size();
+
+    if (serials.size() != M || setSizes.size() != M || fPadding.size() != M) {
+        LogPrintf("Sigma batch verification failed due to inconsistent input sizes.");
+        return false;
+    }
+
+    /*
+     * Every proof j states that (TeX notation)
+     *
+     * \sum_{i} f_{j,i} (A_{s_j-1-i} - s_j g) - \sum_{k} x_j^k G_{j,k} - z_j h_0 = 0
+     *
+     * where A is stored newest last and s_j = setSizes[j]. The equations are multiplied by random weights
+     * w_j and summed up, so the shared commitments A get the scalar \sum_j w_j f_{j,i} and only one
+     * multi-exponentiation over the N commitments is needed instead of M ones. The remaining m * M + 2
+     * points go to a second, small one.
+     */
+    std::vector<Exponent> exponents(N, Exponent(uint64_t(0)));
+    std::vector<GroupElement> points;
+    std::vector<Exponent> pointExponents;
+    points.reserve(m * M + 2);
+    pointExponents.reserve(m * M + 2);
+
+    // The proofs are checked and their f_i computed on the executor, a window of proofs at a time so that the
+    // f_i of only a few of them are kept around. The weights are drawn and summed up in order afterwards.
+    std::size_t window = std::min<std::size_t>(M, 2 * (GetParallelExecutor().GetWorkerCount() + 1));
+    std::vector<Exponent> xs(window);
+    std::vector<std::vector<Exponent>> fs(window);
+    std::vector<char> prepared(window);
+
+    Exponent g_sum(uint64_t(0)), h_sum(uint64_t(0));
+    for (std::size_t start = 0; start < M; start += window) {
+        std::size_t end = std::min(start + window, M);
+        for (std::size_t j = start; j < end; ++j) {
+            if (setSizes[j] == 0 || setSizes[j] > N) {
+                LogPrintf("Sigma batch verification failed due to invalid anonymity set size.");
+                return false;
+            }
+        }
+
+        ParallelFor(end - start, 1, [&](std::size_t slot) {
+            std::size_t j = start + slot;
+            fs[slot].clear();
+            prepared[slot] = prepare(setSizes[j], proofs[j], fPadding[j], xs[slot], fs[slot]);
+        });
+
+        for (std::size_t j = start; j < end; ++j) {
+            const SigmaPlusProof<Exponent, GroupElement>& proof = proofs[j];
+            std::size_t slot = j - start;
+            if (!prepared[slot])
+                return false;
+            const Exponent& x = xs[slot];
+            const std::vector<Exponent>& f_i_ = fs[slot];
+
+            Exponent w;
+            w.randomize();
+
+            std::size_t last = setSizes[j] - 1;
+            Exponent f_sum(uint64_t(0));
+            for (std::size_t i = 0; i < f_i_.size(); ++i) {
+                exponents[last - i] += w * f_i_[i];
+                f_sum += f_i_[i];
+            }
+            g_sum += w * serials[j] * f_sum;
+            h_sum += w * proof.z_;
+
+            Exponent x_k(w);
+            for (int k = 0; k < m; ++k) {
+                points.emplace_back(proof.Gk_[k]);
+                pointExponents.emplace_back(x_k.negate());
+                x_k *= x;
+            }
+        }
+    }
+
+    points.emplace_back(g_);
+    pointExponents.emplace_back(g_sum.negate());
+    points.emplace_back(h_[0]);
+    pointExponents.emplace_back(h_sum.negate());
+
+    secp_primitives::MultiExponent commitsMult(commits, exponents.data(), N);
+    secp_primitives::MultiExponent pointsMult(points, pointExponents);
+    return (commitsMult.get_multiple() + pointsMult.get_multiple()).isInfinity();
+}
+
+template<class Exponent, class GroupElement>
+bool SigmaPlusVerifier<Exponent, GroupElement>::prepare(
+        std::size_t N,
+        const SigmaPlusProof<Exponent, GroupElement>& proof,
+        bool fPadding,
+        Exponent& x,
+        std::vector<Exponent>& f_i_) const {
+
     R1ProofVerifier<Exponent, GroupElement> r1ProofVerifier(g_, h_, proof.B_, n, m);
     std::vector<Exponent> f;
     const R1Proof<Exponent, GroupElement>& r1Proof = proof.r1Proof_;
@@ -44,25 +178,15 @@ bool  SigmaPlusVerifier<Exponent, GroupElement>::verify(
         return false;
     }
 
-    if (commits.empty()) {
+    if (N == 0) {
         LogPrintf("No mints in the anonymity set");
         return false;
     }
 
-    std::size_t N = commits.size();
-
-    std::vector<Exponent> f_i_;
     f_i_.reserve(N);
-    for (std::size_t i = 0; i < (fPadding ? N-1 : N); ++i) {
-        std::vector<uint64_t> I = SigmaPrimitives<Exponent, GroupElement>::convert_to_nal(i, n, m);
-        Exponent f_i(uint64_t(1));
-        for(int j = 0; j < m; ++j){
-            f_i *= f[j*n + I[j]];
-        }
-        f_i_.emplace_back(f_i);
-    }
+    SigmaPrimitives<Exponent, GroupElement>::compute_fs(f, n, m, fPadding ? N-1 : N, f_i_);
 
-    Exponent x = r1ProofVerifier.x_;
+    x = r1ProofVerifier.x_;
 
     if (fPadding) {
         /*
@@ -99,19 +223,6 @@ bool  SigmaPlusVerifier<Exponent, GroupElement>::verify(
         f_i_.emplace_back(pow);
     }
 
-    secp_primitives::MultiExponent mult(commits, f_i_);
-    GroupElement t1 = mult.get_multiple();
-    GroupElement t2;
-    Exponent x_k(uint64_t(1));
-    for(int k = 0; k < m; ++k){
-        t2 += (Gk[k] * (x_k.negate()));
-        x_k *= x;
-    }
-
-    GroupElement left(t1 + t2);
-    if(left != SigmaPrimitives<Exponent, GroupElement>::commit(g_, Exponent(uint64_t(0)), h_[0], proof.z_))
-        return false;
-
     return true;
 }
 
@@ -161,4 +161,68 @@ BOOST_AUTO_TEST_CASE(prove_coin_not_in_set)
     BOOST_CHECK(!verifier.verify(commits,proof));
 }
 
+BOOST_AUTO_TEST_CASE(batch_verify)
+{
+    auto params = sigma::Params::get_default();
+    int N = 1024;
+    int n = params->get_n();
+    int m = params->get_m();
+
+    secp_primitives::GroupElement g;
+    g.randomize();
+    std::vector<secp_primitives::GroupElement> h_gens;
+    h_gens.resize(n * m);
+    for(int i = 0; i < n * m; ++i ){
+        h_gens[i].randomize();
+    }
+    sigma::SigmaPlusProver<secp_primitives::Scalar,secp_primitives::GroupElement> prover(g,h_gens, n, m);
+    sigma::SigmaPlusVerifier<secp_primitives::Scalar,secp_primitives::GroupElement> verifier(g, h_gens, n, m);
+
+    std::vector<secp_primitives::GroupElement> commits;
+    for(int i = 0; i < N; ++i){
+        commits.push_back(secp_primitives::GroupElement());
+        commits[i].randomize();
+    }
+
+    // Proofs over the whole set and over its tail, the way spends of older blocks see a coin group
+    std::vector<std::size_t> setSizes = {std::size_t(N), std::size_t(N - 10), std::size_t(N)};
+    std::vector<std::size_t> indexes = {3, 17, std::size_t(N - 1)};
+    std::vector<bool> fPadding = {true, true, false};
+    std::vector<secp_primitives::Scalar> serials;
+    std::vector<sigma::SigmaPlusProof<secp_primitives::Scalar,secp_primitives::GroupElement>> proofs;
+
+    std::vector<secp_primitives::Scalar> randomness;
+    for (std::size_t j = 0; j < setSizes.size(); ++j) {
+        secp_primitives::Scalar r, s;
+        r.randomize();
+        s.randomize();
+        commits[N - setSizes[j] + indexes[j]] = sigma::SigmaPrimitives<secp_primitives::Scalar,secp_primitives::GroupElement>::commit(g, s, h_gens[0], r);
+        serials.push_back(s);
+        randomness.push_back(r);
+    }
+
+    for (std::size_t j = 0; j < setSizes.size(); ++j) {
+        std::vector<secp_primitives::GroupElement> C_;
+        secp_primitives::GroupElement gs = (g * serials[j]).inverse();
+        for (std::size_t i = N - setSizes[j]; i < commits.size(); ++i)
+            C_.emplace_back(commits[i] + gs);
+
+        sigma::SigmaPlusProof<secp_primitives::Scalar,secp_primitives::GroupElement> proof(params);
+        prover.proof(C_, indexes[j], randomness[j], fPadding[j], proof);
+        BOOST_CHECK(verifier.verify(C_, proof, fPadding[j]));
+        proofs.push_back(proof);
+    }
+
+    BOOST_CHECK(verifier.batch_verify(commits, serials, setSizes, fPadding, proofs));
+
+    // Any inconsistency in one of the proofs should fail the whole batch
+    std::vector<secp_primitives::Scalar> wrongSerials(serials);
+    wrongSerials[1].randomize();
+    BOOST_CHECK(!verifier.batch_verify(commits, wrongSerials, setSizes, fPadding, proofs));
+
+    std::vector<std::size_t> wrongSizes(setSizes);
+    wrongSizes[1] = N;
+    BOOST_CHECK(!verifier.batch_verify(commits, serials, wrongSizes, fPadding, proofs));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <libzerocoin/MontgomeryGroup.h>
+
+#include <test/test_bitcoin.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace libzerocoin;
+
+namespace {
+
+Bignum RandomExponent(int nBits)
+{
+    Bignum exponent = Bignum::randBignum(Bignum(2).pow(nBits));
+    if (Bignum::randBignum(Bignum(2)) == 1)
+        exponent = 0 - exponent;
+    return exponent;
+}
+
+// The product of pow_mod of every term, as the proofs computed it before
+Bignum PowModProduct(const std::vector<std::pair<Bignum, Bignum>>& terms, const Bignum& modulus)
+{
+    Bignum product = 1;
+    for (const std::pair<Bignum, Bignum>& term : terms)
+        product = product * term.first.pow_mod(term.second, modulus);
+    return product % modulus;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(montgomerygroup_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(multiexponentiation_matches_pow_mod)
+{
+    // A safe prime p = 2q + 1, squares have order q
+    Bignum p = Bignum::generatePrime(160, true);
+    Bignum q = (p - 1) / 2;
+    Bignum n = p * Bignum::generatePrime(400);
+
+    for (const Bignum& modulus : {p, n}) {
+        MontgomeryGroup group(modulus);
+        BOOST_CHECK(group.IsValid());
+
+        Bignum g = Bignum::randBignum(modulus).pow_mod(2, modulus);
+        Bignum h = Bignum::randBignum(modulus).pow_mod(2, modulus);
+        // The order is used only for p, for n it's wrong and has to be ignored
+        FixedBase fixedG(group, g, q, modulus.bitSize());
+        FixedBase fixedH(group, h, 0, modulus.bitSize());
+        BOOST_CHECK(fixedG.IsValid() && fixedH.IsValid());
+
+        for (int i = 0; i < 50; i++) {
+            MultiExponentiation multiExp(group);
+            std::vector<std::pair<Bignum, Bignum>> terms;
+
+            // Exponents longer than the tables, zero, and bases that are negative or not reduced
+            Bignum e1 = RandomExponent(1 + i * 31 % (2 * modulus.bitSize()));
+            Bignum e2 = i % 7 == 0 ? Bignum(0) : RandomExponent(1 + i * 17 % (2 * modulus.bitSize()));
+            Bignum e3 = RandomExponent(1 + i * 13 % 300);
+            Bignum base = Bignum::randBignum(modulus * 4) - modulus;
+
+            multiExp.Add(fixedG, e1);
+            terms.push_back(std::make_pair(g, e1));
+            multiExp.Add(fixedH, e2);
+            terms.push_back(std::make_pair(h, e2));
+            multiExp.Add(base, e3);
+            terms.push_back(std::make_pair(base, e3));
+            if (i % 2) {
+                multiExp.Add(Bignum::randBignum(modulus), 0);
+                Bignum e4 = RandomExponent(1 + i * 7 % 600);
+                multiExp.Add(h, e4);
+                terms.push_back(std::make_pair(h, e4));
+            }
+
+            BOOST_CHECK(multiExp.Compute() == PowModProduct(terms, modulus));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(multiexponentiation_errors_and_fallback)
+{
+    Bignum p = Bignum::generatePrime(128);
+    Bignum n = p * Bignum::generatePrime(128);
+    MontgomeryGroup group(n);
+
+    // A negative power of a base without inverse throws like pow_mod, a positive one doesn't
+    MultiExponentiation multiExp(group);
+    BOOST_CHECK_THROW(multiExp.Add(p * 3, -5), bignum_error);
+    multiExp.Add(p * 3, 5);
+    BOOST_CHECK(multiExp.Compute() == (p * 3).pow_mod(5, n));
+
+    FixedBase noInverse(group, p, 0, 128);
+    BOOST_CHECK(!noInverse.IsValid());
+
+    // An even modulus can't be used in Montgomery form, the products are computed with pow_mod
+    Bignum even = n * 2;
+    MontgomeryGroup evenGroup(even);
+    BOOST_CHECK(!evenGroup.IsValid());
+    FixedBase fixed(evenGroup, 3, 0, 128);
+    BOOST_CHECK(!fixed.IsValid());
+
+    Bignum e1 = RandomExponent(200), e2 = RandomExponent(100);
+    MultiExponentiation evenMultiExp(evenGroup);
+    evenMultiExp.Add(fixed, e1);
+    evenMultiExp.Add(7, e2);
+    BOOST_CHECK(evenMultiExp.Compute() == (Bignum(3).pow_mod(e1, even) * Bignum(7).pow_mod(e2, even)) % even);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
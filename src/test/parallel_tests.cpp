@@ -0,0 +1,90 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <parallel.h>
+#include <libzerocoin/ParallelTasks.h>
+
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(parallel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(parallel_for)
+{
+    std::vector<int> values(10000, 0);
+    ParallelFor(values.size(), 1, [&values](std::size_t i) { values[i] += i; });
+    for (std::size_t i = 0; i < values.size(); i++)
+        BOOST_CHECK_EQUAL(values[i], (int)i);
+
+    // Nothing to do, and fewer indexes than a chunk runs on the calling thread
+    ParallelFor(0, 1, [](std::size_t) { BOOST_ERROR("called for an empty range"); });
+    std::thread::id caller = std::this_thread::get_id();
+    ParallelFor(10, 100, [caller](std::size_t) { BOOST_CHECK(std::this_thread::get_id() == caller); });
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_nested)
+{
+    // Tasks waiting for their own tasks help running them instead of blocking a worker
+    std::vector<std::atomic<int>> counts(64 * 64);
+    for (std::atomic<int> &count : counts)
+        count = 0;
+    ParallelFor(64, 1, [&counts](std::size_t i) {
+        ParallelFor(64, 1, [&counts, i](std::size_t j) { counts[i * 64 + j]++; });
+    });
+    for (std::atomic<int> &count : counts)
+        BOOST_CHECK_EQUAL(count.load(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_concurrent_callers)
+{
+    std::atomic<long> total(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&total] {
+            for (int n = 0; n < 100; n++)
+                ParallelFor(100, 1, [&total](std::size_t i) { total += i; });
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    BOOST_CHECK_EQUAL(total.load(), 4L * 100 * 4950);
+    BOOST_CHECK_EQUAL(GetParallelExecutorStats().nQueued, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for_exception)
+{
+    std::atomic<int> nRun(0);
+    BOOST_CHECK_THROW(ParallelFor(1000, 1, [&nRun](std::size_t i) {
+        nRun++;
+        if (i == 500)
+            throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    // The other chunks still ran before the exception was rethrown
+    BOOST_CHECK(nRun.load() >= 500);
+    BOOST_CHECK_EQUAL(GetParallelExecutorStats().nQueued, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_parallel_tasks)
+{
+    std::vector<int> values(100, 0);
+    libzerocoin::ParallelTasks tasks;
+    for (int i = 0; i < 100; i++)
+        tasks.Add([i, &values] { values[i] = 2 * i; });
+    tasks.Wait();
+    for (int i = 0; i < 100; i++)
+        BOOST_CHECK_EQUAL(values[i], 2 * i);
+
+    tasks.Reset();
+    tasks.Add([&values] { values[0] = -1; });
+    tasks.Wait();
+    BOOST_CHECK_EQUAL(values[0], -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
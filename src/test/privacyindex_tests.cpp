@@ -0,0 +1,81 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <txdb.h>
+
+#include <test/test_bitcoin.h>
+
+#include <map>
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+struct RegtestingSetup : public TestingSetup {
+    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+BOOST_FIXTURE_TEST_SUITE(privacyindex_tests, RegtestingSetup)
+
+BOOST_AUTO_TEST_CASE(load_legacy_block_index)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    CBlockTreeDB blockTree(1 << 20, true);
+    CPrivacyIndexDB privacyIndex(1 << 20, true);
+
+    // A record written by an older release, still carrying the privacy data of its block
+    CBlockIndex legacy;
+    legacy.nHeight = 1;
+    legacy.nStatus = BLOCK_VALID_TREE;
+    legacy.nBits = UintToArith256(consensusParams.powLimit).GetCompact();
+    while (!CheckProofOfWork(legacy.GetBlockPoWHash(), legacy.nBits, consensusParams))
+        ++legacy.nNonce;
+    const uint256 hash = legacy.GetBlockHash();
+    legacy.phashBlock = &hash;
+
+    CDiskBlockIndex diskindex(&legacy);
+    diskindex.privacyData.mintedPubCoins[std::make_pair(1, 1)].push_back(CBigNum(12345));
+    diskindex.privacyData.accumulatorChanges[std::make_pair(1, 1)] = std::make_pair(CBigNum(67890), 1);
+    BOOST_CHECK(blockTree.Write(std::make_pair('b', hash), diskindex));
+
+    std::map<uint256, std::unique_ptr<CBlockIndex>> mapIndex;
+    auto insertBlockIndex = [&mapIndex](const uint256& h) -> CBlockIndex* {
+        if (h.IsNull())
+            return nullptr;
+        std::unique_ptr<CBlockIndex>& pindex = mapIndex[h];
+        if (!pindex) {
+            pindex.reset(new CBlockIndex());
+            pindex->phashBlock = &mapIndex.find(h)->first;
+        }
+        return pindex.get();
+    };
+    BOOST_CHECK(blockTree.LoadBlockIndexGuts(consensusParams, insertBlockIndex, privacyIndex));
+    BOOST_REQUIRE(mapIndex.count(hash));
+
+    // The privacy data was moved to the privacy index
+    std::shared_ptr<const CBlockPrivacyData> data = privacyIndex.ReadBlockData(mapIndex[hash].get());
+    BOOST_REQUIRE(data);
+    BOOST_CHECK(data->mintedPubCoins == diskindex.privacyData.mintedPubCoins);
+    BOOST_CHECK(data->accumulatorChanges == diskindex.privacyData.accumulatorChanges);
+
+    // The record was rewritten without it
+    CDiskBlockIndex rewritten;
+    BOOST_CHECK(blockTree.Read(std::make_pair('b', hash), rewritten));
+    BOOST_CHECK(rewritten.privacyData.IsNull());
+    BOOST_CHECK(rewritten.GetBlockHash() == hash);
+
+    // Older releases fail to read the version marker as a block index record
+    CDiskBlockIndex marker;
+    BOOST_CHECK(blockTree.Exists(std::make_pair('b', uint256())));
+    BOOST_CHECK(!blockTree.Read(std::make_pair('b', uint256()), marker));
+
+    // A second load finds nothing left to migrate
+    mapIndex.clear();
+    BOOST_CHECK(blockTree.LoadBlockIndexGuts(consensusParams, insertBlockIndex, privacyIndex));
+    BOOST_CHECK_EQUAL(mapIndex.size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
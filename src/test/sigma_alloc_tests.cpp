@@ -0,0 +1,113 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <sigma/coin.h>
+#include <sigma/coinspend.h>
+#include <sigma/params.h>
+#include <sigma/sigmaplus_verifier.h>
+
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+// Global operator new of the test binary counts allocations only while an AllocationCounter is alive, every other
+// allocation costs one relaxed load more
+static std::atomic<bool> fCountAllocations(false);
+static std::atomic<uint64_t> nAllocations(0);
+
+void* operator new(std::size_t size)
+{
+    if (fCountAllocations.load(std::memory_order_relaxed))
+        nAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+class AllocationCounter
+{
+private:
+    uint64_t nStart;
+
+public:
+    AllocationCounter() : nStart(nAllocations.load())
+    {
+        fCountAllocations = true;
+    }
+
+    ~AllocationCounter()
+    {
+        fCountAllocations = false;
+    }
+
+    uint64_t Count() const
+    {
+        return nAllocations.load() - nStart;
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(sigma_alloc_tests, BasicTestingSetup)
+
+// One proof over a padded anonymity set, the way the CheckSigmaSpendTransaction mempool path verifies it
+BOOST_AUTO_TEST_CASE(sigma_verify_allocations)
+{
+    const std::size_t nSetSize = 1024;
+
+    sigma::Params* params = sigma::Params::get_default();
+    std::vector<sigma::PublicCoin> anonymitySet;
+    sigma::PrivateCoin coin(params, sigma::CoinDenomination::SIGMA_1);
+    for (std::size_t i = 0; i < nSetSize - 1; ++i)
+        anonymitySet.push_back(sigma::PrivateCoin(params, sigma::CoinDenomination::SIGMA_1).getPublicCoin());
+    anonymitySet.push_back(coin.getPublicCoin());
+
+    sigma::SpendMetaData metaData(0, uint256(), uint256());
+    sigma::CoinSpend spend(params, coin, anonymitySet, metaData, true);
+
+    std::vector<secp_primitives::GroupElement> commits;
+    commits.reserve(nSetSize);
+    secp_primitives::GroupElement gs = (params->get_g() * spend.getCoinSerialNumber()).inverse();
+    for (const sigma::PublicCoin& pubCoin : anonymitySet)
+        commits.emplace_back(pubCoin.getValue() + gs);
+
+    sigma::SigmaPlusVerifier<secp_primitives::Scalar, secp_primitives::GroupElement> verifier(
+            params->get_g(), params->get_h(), params->get_n(), params->get_m());
+
+    uint64_t nCount;
+    bool fValid;
+    {
+        AllocationCounter counter;
+        fValid = verifier.verify(commits, spend.getProof(), true);
+        nCount = counter.Count();
+    }
+    BOOST_CHECK(fValid);
+    // 6369 while GroupElement and Scalar kept their limbs on the heap, about 4100 with inline limbs
+    BOOST_CHECK_MESSAGE(nCount < 5000, nCount << " allocations per verify of " << nSetSize << " commitments");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <random.h>
+#include <zerocoin/sigma.h>
+
+#include <test/test_bitcoin.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// Blocks of a chain that exists only in the block index, the privacy data is passed to the state directly
+struct FakeChain {
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    CChain chain;
+
+    explicit FakeChain(int nHeight) : hashes(nHeight + 1), blocks(nHeight + 1) {
+        for (int i = 0; i <= nHeight; i++) {
+            hashes[i] = GetRandHash();
+            blocks[i].nHeight = i;
+            blocks[i].phashBlock = &hashes[i];
+            blocks[i].pprev = i > 0 ? &blocks[i - 1] : NULL;
+        }
+        chain.SetTip(&blocks.back());
+    }
+};
+
+sigma::PublicCoin RandomCoin(sigma::CoinDenomination denomination) {
+    GroupElement value;
+    value.randomize();
+    return sigma::PublicCoin(value, denomination);
+}
+
+void AddMints(CBlockPrivacyData &data, sigma::CoinDenomination denomination, int id, int nCoins) {
+    for (int i = 0; i < nCoins; i++)
+        data.mintedPubCoinsV2[std::make_pair(denomination, id)].push_back(RandomCoin(denomination));
+}
+
+Scalar AddSpend(CBlockPrivacyData &data) {
+    Scalar serial;
+    serial.randomize();
+    data.spentSerialsV2.insert(serial);
+    return serial;
+}
+
+void CheckSameGroup(CSigmaState &state, CSigmaState &loaded, sigma::CoinDenomination denomination, int id,
+        const uint256 &blockHash) {
+    CSigmaState::CoinGroupInfo info, loadedInfo;
+    BOOST_REQUIRE(state.GetCoinGroupInfo(denomination, id, info));
+    BOOST_REQUIRE(loaded.GetCoinGroupInfo(denomination, id, loadedInfo));
+    BOOST_CHECK(info.firstBlock == loadedInfo.firstBlock);
+    BOOST_CHECK(info.lastBlock == loadedInfo.lastBlock);
+    BOOST_CHECK_EQUAL(info.nCoins, loadedInfo.nCoins);
+
+    sigma::AnonymitySetView set = state.GetAnonymitySet(denomination, id, blockHash);
+    sigma::AnonymitySetView loadedSet = loaded.GetAnonymitySet(denomination, id, blockHash);
+    BOOST_REQUIRE_EQUAL(set.size(), loadedSet.size());
+    for (std::size_t i = 0; i < set.size(); i++) {
+        BOOST_CHECK(set[i] == loadedSet[i]);
+        BOOST_CHECK(loaded.HasCoin(sigma::PublicCoin(set[i], denomination)));
+    }
+    BOOST_CHECK((bool)state.GetSealedGroup(denomination, id) == (bool)loaded.GetSealedGroup(denomination, id));
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(sigma_state_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_round_trip)
+{
+    FakeChain fake(3);
+    CBlockIndex *tip = &fake.blocks[3];
+
+    // A second block at the height of the tip, for the reorganization
+    uint256 forkHash = GetRandHash();
+    CBlockIndex fork;
+    fork.nHeight = 3;
+    fork.phashBlock = &forkHash;
+    fork.pprev = &fake.blocks[2];
+
+    std::vector<CBlockPrivacyData> data(4);
+    AddMints(data[1], sigma::CoinDenomination::SIGMA_1, 1, 3);
+    AddMints(data[2], sigma::CoinDenomination::SIGMA_1, 2, 2);
+    Scalar serial1 = AddSpend(data[2]);
+    AddMints(data[3], sigma::CoinDenomination::SIGMA_10, 1, 1);
+    Scalar serial2 = AddSpend(data[3]);
+    CBlockPrivacyData forkData;
+    AddMints(forkData, sigma::CoinDenomination::SIGMA_10, 1, 2);
+    Scalar serial3 = AddSpend(forkData);
+
+    CSigmaState state;
+    for (int i = 1; i <= 3; i++)
+        state.AddBlock(&fake.blocks[i], data[i]);
+    BOOST_CHECK(state.WriteSnapshot(tip));
+    // No mint goes to the first group of the denomination anymore, the snapshot sealed it
+    BOOST_CHECK(state.GetSealedGroup(sigma::CoinDenomination::SIGMA_1, 1));
+
+    CSigmaState loaded;
+    BOOST_CHECK(loaded.ReadSnapshot(&fake.chain) == tip);
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_1, 1, tip->GetBlockHash());
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_1, 2, tip->GetBlockHash());
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_10, 1, tip->GetBlockHash());
+    BOOST_CHECK_EQUAL(loaded.GetLatestCoinID(sigma::CoinDenomination::SIGMA_1), 2);
+    BOOST_CHECK_EQUAL(loaded.GetLatestCoinID(sigma::CoinDenomination::SIGMA_10), 1);
+    BOOST_CHECK(loaded.IsUsedCoinSerial(serial1));
+    BOOST_CHECK(loaded.IsUsedCoinSerial(serial2));
+
+    // The next snapshot only writes what the reorganization changed, the rest must still be there
+    state.RemoveBlock(tip, data[3]);
+    state.AddBlock(&fork, forkData);
+    fake.chain.SetTip(&fork);
+    BOOST_CHECK(state.WriteSnapshot(&fork));
+
+    BOOST_CHECK(loaded.ReadSnapshot(&fake.chain) == &fork);
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_1, 1, forkHash);
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_1, 2, forkHash);
+    CheckSameGroup(state, loaded, sigma::CoinDenomination::SIGMA_10, 1, forkHash);
+    BOOST_CHECK(loaded.IsUsedCoinSerial(serial1));
+    BOOST_CHECK(!loaded.IsUsedCoinSerial(serial2));
+    BOOST_CHECK(loaded.IsUsedCoinSerial(serial3));
+
+    // A snapshot of a block that left the chain is ignored and leaves the state empty
+    fake.chain.SetTip(tip);
+    BOOST_CHECK(loaded.ReadSnapshot(&fake.chain) == NULL);
+    BOOST_CHECK_EQUAL(loaded.GetLatestCoinID(sigma::CoinDenomination::SIGMA_1), 0);
+    BOOST_CHECK(!loaded.IsUsedCoinSerial(serial1));
+    CSigmaState::CoinGroupInfo info;
+    BOOST_CHECK(!loaded.GetCoinGroupInfo(sigma::CoinDenomination::SIGMA_1, 1, info));
+}
+
+BOOST_AUTO_TEST_CASE(anonymity_set_outlives_changes)
+{
+    // Blocks 1-20 mint to the first group of the denomination, the later ones to the second, after which the
+    // first group is sealed. Disconnecting the blocks reopens it
+    FakeChain fake(30);
+    std::vector<CBlockPrivacyData> data(31);
+    std::vector<GroupElement> expected;
+    for (int i = 1; i <= 30; i++) {
+        AddMints(data[i], sigma::CoinDenomination::SIGMA_1, i <= 20 ? 1 : 2, 2);
+        const std::vector<sigma::PublicCoin> &coins = data[i].mintedPubCoinsV2.begin()->second;
+        if (i <= 20) {
+            for (auto coin = coins.rbegin(); coin != coins.rend(); ++coin)
+                expected.push_back(coin->getValue());
+        }
+    }
+
+    CSigmaState state;
+    std::atomic<bool> fDone(false);
+    std::atomic<int> nChecked(0), nMismatches(0);
+
+    // Checks blocks the way a block check does, without cs_main, while blocks are connected and disconnected
+    std::thread checker([&]() {
+        while (!fDone) {
+            int nHeight = 1 + nChecked % 20;
+            CBlockIndex *setBlock;
+            sigma::AnonymitySetView set = state.GetAnonymitySet(
+                sigma::CoinDenomination::SIGMA_1, 1, fake.blocks[nHeight].GetBlockHash(), &setBlock);
+            if (setBlock != &fake.blocks[nHeight])
+                continue;
+            for (int k = 0; k < 2 * nHeight; k++) {
+                if (!(set.data()[k] == expected[k]))
+                    nMismatches++;
+            }
+            nChecked++;
+        }
+    });
+
+    // Enough rounds for the checker to have seen the sets change under it
+    for (int nRound = 0; nRound < 50 || (nChecked < 100 && nRound < 10000); nRound++) {
+        for (int i = 1; i <= 30; i++) {
+            LOCK(cs_main);
+            state.AddBlock(&fake.blocks[i], data[i]);
+            if (i == 25)
+                state.SealGroups();
+        }
+        for (int i = 30; i >= 1; i--) {
+            LOCK(cs_main);
+            state.RemoveBlock(&fake.blocks[i], data[i]);
+        }
+    }
+    fDone = true;
+    checker.join();
+
+    BOOST_CHECK_EQUAL(nMismatches, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
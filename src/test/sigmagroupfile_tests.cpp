@@ -0,0 +1,137 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/sha256.h>
+#include <zerocoin/sigmagroupfile.h>
+
+#include <test/test_bitcoin.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using secp_primitives::GroupElement;
+
+namespace {
+
+// Layout of the header of a group file: magic, version, size of a coin, number of coins, first and last coin
+// serialized, checksum of the coins. The coins start at offset 128
+const long HEADER_ELEMENT_SIZE_OFFSET = 8;
+const long HEADER_CHECKSUM_OFFSET = 4 + 4 + 4 + 8 + 2 * GroupElement::serialize_size;
+const long HEADER_SIZE = 128;
+
+struct GroupFileSetup : public BasicTestingSetup {
+    fs::path dir;
+    fs::path path;
+    std::vector<GroupElement> values;
+
+    GroupFileSetup() : dir(fs::temp_directory_path() / fs::unique_path("sigmagroupfile_%%%%%%%%")), path(dir / "group-1-1.dat"), values(100) {
+        for (GroupElement &value : values)
+            value.randomize();
+    }
+
+    ~GroupFileSetup() {
+        fs::remove_all(dir);
+    }
+
+    std::vector<unsigned char> ReadFile() const {
+        std::vector<unsigned char> data(fs::file_size(path));
+        FILE *file = fsbridge::fopen(path, "rb");
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE(fread(data.data(), 1, data.size(), file) == data.size());
+        fclose(file);
+        return data;
+    }
+
+    void WriteFile(const std::vector<unsigned char> &data) const {
+        FILE *file = fsbridge::fopen(path, "wb");
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE(fwrite(data.data(), 1, data.size(), file) == data.size());
+        fclose(file);
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(sigmagroupfile_tests, GroupFileSetup)
+
+BOOST_AUTO_TEST_CASE(group_file_round_trip)
+{
+    std::shared_ptr<const CSigmaGroupFile> file = CSigmaGroupFile::Create(path, values.data(), values.size());
+    BOOST_REQUIRE(file);
+    BOOST_REQUIRE_EQUAL(file->size(), values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+        BOOST_CHECK(file->data()[i] == values[i]);
+
+    std::shared_ptr<const CSigmaGroupFile> opened = CSigmaGroupFile::Open(path, file->GetChecksum());
+    BOOST_REQUIRE(opened);
+    BOOST_CHECK_EQUAL(opened->size(), values.size());
+    BOOST_CHECK(opened->data()[values.size() - 1] == values.back());
+
+    // Another group's checksum
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, uint256()));
+
+    // Replacing the file leaves the mapping of the old one intact
+    std::vector<GroupElement> others(10);
+    for (GroupElement &value : others)
+        value.randomize();
+    BOOST_CHECK(CSigmaGroupFile::Create(path, others.data(), others.size()));
+    BOOST_CHECK(file->data()[0] == values[0]);
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, file->GetChecksum()));
+}
+
+BOOST_AUTO_TEST_CASE(group_file_missing_or_corrupt)
+{
+    BOOST_CHECK(!CSigmaGroupFile::Create(path, values.data(), 0));
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, uint256()));
+
+    std::shared_ptr<const CSigmaGroupFile> file = CSigmaGroupFile::Create(path, values.data(), values.size());
+    BOOST_REQUIRE(file);
+    const uint256 checksum = file->GetChecksum();
+    const std::vector<unsigned char> original = ReadFile();
+    // The files below are written in place, the mapping mustn't see it
+    file.reset();
+
+    // Missing
+    fs::remove(path);
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, checksum));
+
+    // Shorter than its header
+    WriteFile(std::vector<unsigned char>(original.begin(), original.begin() + HEADER_SIZE / 2));
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, checksum));
+
+    // Truncated in the middle of the coins
+    WriteFile(std::vector<unsigned char>(original.begin(), original.end() - sizeof(GroupElement) / 2));
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, checksum));
+
+    // A changed coin fails the checksum
+    std::vector<unsigned char> data = original;
+    data[HEADER_SIZE + sizeof(GroupElement) + 3] ^= 1;
+    WriteFile(data);
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, checksum));
+
+    // Written with another size of GroupElement
+    data = original;
+    data[HEADER_ELEMENT_SIZE_OFFSET] ^= 8;
+    WriteFile(data);
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, checksum));
+
+    // Coins laid out differently, with a checksum that matches them, fail the check of the first and last coin
+    data = original;
+    std::swap_ranges(data.begin() + HEADER_SIZE, data.begin() + HEADER_SIZE + sizeof(GroupElement),
+        data.end() - sizeof(GroupElement));
+    uint256 swappedChecksum;
+    CSHA256().Write(data.data() + HEADER_SIZE, data.size() - HEADER_SIZE).Finalize(swappedChecksum.begin());
+    std::copy(swappedChecksum.begin(), swappedChecksum.end(), data.begin() + HEADER_CHECKSUM_OFFSET);
+    WriteFile(data);
+    BOOST_CHECK(!CSigmaGroupFile::Open(path, swappedChecksum));
+
+    // The original opens again
+    WriteFile(original);
+    BOOST_CHECK(CSigmaGroupFile::Open(path, checksum));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <miner.h>
+#include <validation.h>
+#include <zerocoin/zerocoin.h>
+
+#include <test/test_bitcoin.h>
+
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(witness_cache_ignores_checked_blocks)
+{
+    const CChainParams& chainparams = Params();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CZerocoinState *zcState = CZerocoinState::GetZerocoinState();
+    CBigNum pubCoin = libzerocoin::PrivateCoin(ZCParams, libzerocoin::ZQ_ONE).getPublicCoin().getValue();
+    CBigNum witness;
+
+    {
+        LOCK(cs_main);
+        // A coin minted at the tip, its cached witness is then up to date with the tip
+        CBigNum accValue = ZCParams->accumulatorParams.accumulatorBase;
+        int id = zcState->AddMint(chainActive.Tip(), libzerocoin::ZQ_ONE, pubCoin, accValue);
+        witness = zcState->GetWitnessForSpend(&chainActive, chainActive.Height(), libzerocoin::ZQ_ONE, id, pubCoin).getValue();
+        BOOST_CHECK(witness == ZCParams->accumulatorParams.accumulatorBase);
+
+        // A block template is connected on a dummy index without hash, the cached witness mustn't follow it
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+        CValidationState state;
+        TestBlockValidity(state, chainparams, pblocktemplate->block, chainActive.Tip(), false, false);
+        BOOST_CHECK(zcState->GetWitnessForSpend(&chainActive, chainActive.Height(), libzerocoin::ZQ_ONE, id, pubCoin).getValue() == witness);
+    }
+
+    // A block connected for real extends it, it has no mints so the witness stays the same
+    CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptPubKey);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(zcState->GetWitnessForSpend(&chainActive, chainActive.Height(), libzerocoin::ZQ_ONE, 1, pubCoin).getValue() == witness);
+        zcState->Reset();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(witness_cache_reorg_past_checkpoints)
+{
+    LOCK(cs_main);
+    CZerocoinState *zcState = CZerocoinState::GetZerocoinState();
+    const CBigNum &modulus = ZCParams->accumulatorParams.accumulatorModulus;
+    const std::pair<int, int> denomAndId(libzerocoin::ZQ_ONE, 1);
+
+    // Blocks 10 to 40 mint one coin each, the coin of block 10 is the one spent
+    std::map<int, CBlockPrivacyData> blockData;
+    CBigNum accValue = ZCParams->accumulatorParams.accumulatorBase;
+    for (int nHeight = 10; nHeight <= 40; nHeight++) {
+        CBigNum pubCoin = CBigNum::randBignum(CBigNum(2).pow(256));
+        accValue = accValue.pow_mod(pubCoin, modulus);
+        CBlockPrivacyData &data = blockData[nHeight];
+        data.mintedPubCoins[denomAndId].push_back(pubCoin);
+        data.accumulatorChanges[denomAndId] = std::make_pair(accValue, 1);
+        BOOST_CHECK(pprivacyindex->WriteBlockData(chainActive[nHeight], data));
+        zcState->AddBlock(chainActive[nHeight], data);
+    }
+    const CBigNum &spentCoin = blockData[10].mintedPubCoins[denomAndId][0];
+
+    // The witness is asked for at every tip, so it keeps more checkpoints than it can hold
+    CChain chain;
+    for (int nHeight = 10; nHeight <= 40; nHeight++) {
+        chain.SetTip(chainActive[nHeight]);
+        zcState->GetWitnessForSpend(&chain, nHeight, libzerocoin::ZQ_ONE, 1, spentCoin);
+    }
+
+    // Disconnect every block down to the mint block's checkpoint, then connect one of them again
+    for (int nHeight = 40; nHeight > 15; nHeight--) {
+        zcState->RemoveBlock(chainActive[nHeight], blockData[nHeight]);
+        chain.SetTip(chainActive[nHeight - 1]);
+    }
+    zcState->AddBlock(chainActive[16], blockData[16]);
+    zcState->UpdateCoinWitnesses(chainActive[16], blockData[16]);
+    chain.SetTip(chainActive[16]);
+
+    CBigNum expected = ZCParams->accumulatorParams.accumulatorBase;
+    for (int nHeight = 11; nHeight <= 16; nHeight++)
+        expected = expected.pow_mod(blockData[nHeight].mintedPubCoins[denomAndId][0], modulus);
+    BOOST_CHECK(zcState->GetWitnessForSpend(&chain, 16, libzerocoin::ZQ_ONE, 1, spentCoin).getValue() == expected);
+
+    zcState->Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
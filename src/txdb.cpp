@@ -38,6 +38,20 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
+/**
+ * Version of the block index records, stored under the block index key of the null hash. Since version 1 the privacy
+ * data lives in the privacy index and the records have none. Older releases can't read the marker as a block index
+ * record and refuse to load the database instead of rebuilding their Zerocoin and Sigma state from empty data.
+ */
+static const uint8_t BLOCK_INDEX_VERSION = 1;
+
+static const char DB_PRIVACY_BLOCK = 'p';
+static const char DB_PRIVACY_MINT = 'm';
+static const char DB_PRIVACY_SIGMA_STATE = 'S';
+static const char DB_PRIVACY_SIGMA_SERIAL = 's';
+static const char DB_PRIVACY_SIGMA_GROUP = 'g';
+static const char DB_PRIVACY_ZEROCOIN_WITNESS = 'w';
+
 namespace {
 
 struct CoinEntry {
@@ -241,6 +255,8 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
+    if (!blockinfo.empty())
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, uint256()), BLOCK_INDEX_VERSION);
     return WriteBatch(batch, true);
 }
 
@@ -413,9 +429,11 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, CPrivacyIndexDB& privacyIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::vector<const CBlockIndex*> vMigrated;
+    bool fHaveVersion = false;
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
@@ -423,7 +441,15 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
+        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX && key.second.IsNull()) {
+            uint8_t nVersion;
+            if (!pcursor->GetValue(nVersion))
+                return error("%s: failed to read block index version", __func__);
+            if (nVersion > BLOCK_INDEX_VERSION)
+                return error("%s: block index version %d is newer than this release supports", __func__, nVersion);
+            fHaveVersion = true;
+            pcursor->Next();
+        } else if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
                 // Construct block index object
@@ -441,14 +467,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
-                //zerocoin
-                pindexNew->accumulatorChanges = diskindex.accumulatorChanges;
-                pindexNew->mintedPubCoins     = diskindex.mintedPubCoins;
-                pindexNew->spentSerials       = diskindex.spentSerials;
-
-                pindexNew->accumulatorChangesV2 = diskindex.accumulatorChangesV2;
-                pindexNew->mintedPubCoinsV2     = diskindex.mintedPubCoinsV2;
-                pindexNew->spentSerialsV2       = diskindex.spentSerialsV2;
+                //zerocoin and sigma, move the data of old records to the privacy index
+                if (!diskindex.privacyData.IsNull()) {
+                    if (!privacyIndex.WriteBlockData(pindexNew, diskindex.privacyData))
+                        return error("%s: failed to write privacy data: %s", __func__, pindexNew->ToString());
+                    vMigrated.push_back(pindexNew);
+                }
 
                 //PoS
                 if(diskindex.IsProofOfStake() || diskindex.nHeight >= Params().GetConsensus().nPosHeightActivate){
@@ -473,9 +497,183 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         }
     }
 
+    if (!vMigrated.empty() || !fHaveVersion) {
+        // Rewrite the migrated records without their privacy data once it is safely in the privacy index, together
+        // with the version marker that keeps older releases from loading them
+        if (!vMigrated.empty())
+            LogPrintf("%s: moved privacy data of %u blocks to the privacy index\n", __func__, vMigrated.size());
+        if (!privacyIndex.Sync())
+            return error("%s: failed to write privacy index", __func__);
+        CDBBatch batch(*this);
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, uint256()), BLOCK_INDEX_VERSION);
+        for (const CBlockIndex* pindex : vMigrated)
+            batch.Write(std::make_pair(DB_BLOCK_INDEX, pindex->GetBlockHash()), CDiskBlockIndex(pindex));
+        if (!WriteBatch(batch, true))
+            return error("%s: failed to rewrite block index", __func__);
+    }
+
+    return true;
+}
+
+CPrivacyIndexDB::CPrivacyIndexDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "privacy", nCacheSize, fMemory, fWipe) {
+}
+
+std::shared_ptr<const CBlockPrivacyData> CPrivacyIndexDB::ReadBlockData(const CBlockIndex* pindex) {
+    // Most blocks have no privacy data, they all share this one
+    static const std::shared_ptr<const CBlockPrivacyData> emptyData = std::make_shared<CBlockPrivacyData>();
+
+    const uint256 hash = pindex->GetBlockHash();
+    LOCK(cs_cache);
+    auto it = cacheMap.find(hash);
+    if (it != cacheMap.end()) {
+        cacheList.splice(cacheList.begin(), cacheList, it->second);
+        return it->second->second;
+    }
+
+    std::shared_ptr<CBlockPrivacyData> data = std::make_shared<CBlockPrivacyData>();
+    std::shared_ptr<const CBlockPrivacyData> result = emptyData;
+    if (Read(std::make_pair(DB_PRIVACY_BLOCK, std::make_pair(pindex->nHeight, hash)), *data))
+        result = data;
+
+    CacheBlockData(hash, result);
+    return result;
+}
+
+bool CPrivacyIndexDB::WriteBlockData(const CBlockIndex* pindex, const CBlockPrivacyData& data) {
+    const uint256 hash = pindex->GetBlockHash();
+    auto key = std::make_pair(DB_PRIVACY_BLOCK, std::make_pair(pindex->nHeight, hash));
+    LOCK(cs_cache);
+    if (!(data.IsNull() ? Erase(key) : Write(key, data)))
+        return false;
+
+    CacheBlockData(hash, std::make_shared<CBlockPrivacyData>(data));
+    return true;
+}
+
+bool CPrivacyIndexDB::ReadMintLocator(const uint256& pubCoinValueHash, CSigmaMintLocator& locator) {
+    return Read(std::make_pair(DB_PRIVACY_MINT, pubCoinValueHash), locator);
+}
+
+bool CPrivacyIndexDB::WriteMintLocators(const std::vector<std::pair<uint256, CSigmaMintLocator>>& locators) {
+    CDBBatch batch(*this);
+    for (const std::pair<uint256, CSigmaMintLocator>& locator : locators)
+        batch.Write(std::make_pair(DB_PRIVACY_MINT, locator.first), locator.second);
+    return WriteBatch(batch);
+}
+
+bool CPrivacyIndexDB::EraseMintLocators(const std::vector<uint256>& pubCoinValueHashes, const uint256& blockHash) {
+    CDBBatch batch(*this);
+    for (const uint256& hash : pubCoinValueHashes) {
+        // The same value may have been minted by another block that stays in the chain
+        CSigmaMintLocator locator;
+        if (ReadMintLocator(hash, locator) && locator.blockHash == blockHash)
+            batch.Erase(std::make_pair(DB_PRIVACY_MINT, hash));
+    }
+    return WriteBatch(batch);
+}
+
+bool CPrivacyIndexDB::ReadZerocoinWitness(const CZerocoinWitnessKey& key, CZerocoinWitnessRecord& record) {
+    return Read(std::make_pair(DB_PRIVACY_ZEROCOIN_WITNESS, key), record);
+}
+
+bool CPrivacyIndexDB::WriteZerocoinWitness(const CZerocoinWitnessKey& key, const CZerocoinWitnessRecord& record) {
+    return Write(std::make_pair(DB_PRIVACY_ZEROCOIN_WITNESS, key), record);
+}
+
+bool CPrivacyIndexDB::EraseZerocoinWitness(const CZerocoinWitnessKey& key) {
+    return Erase(std::make_pair(DB_PRIVACY_ZEROCOIN_WITNESS, key));
+}
+
+bool CPrivacyIndexDB::ReadSigmaStateSnapshot(std::vector<unsigned char>& snapshot, std::vector<secp_primitives::Scalar>& serials) {
+    if (!Read(DB_PRIVACY_SIGMA_STATE, snapshot))
+        return false;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(DB_PRIVACY_SIGMA_SERIAL);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        // Keys of other records may not be valid serials, the prefix is checked first
+        char prefix;
+        std::pair<char, secp_primitives::Scalar> key;
+        if (pcursor->GetKey(prefix) && prefix == DB_PRIVACY_SIGMA_SERIAL) {
+            if (!pcursor->GetKey(key))
+                return error("%s: failed to read spent serial", __func__);
+            serials.push_back(key.second);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
     return true;
 }
 
+bool CPrivacyIndexDB::ReadSigmaCoinGroup(const std::pair<int, int>& group, std::vector<unsigned char>& data) {
+    return Read(std::make_pair(DB_PRIVACY_SIGMA_GROUP, group), data);
+}
+
+bool CPrivacyIndexDB::WriteSigmaStateSnapshot(const std::vector<unsigned char>& snapshot,
+        const std::vector<std::pair<secp_primitives::Scalar, bool>>& serials,
+        const std::vector<std::pair<std::pair<int, int>, std::vector<unsigned char>>>& groups, bool fRewrite) {
+    CDBBatch batch(*this);
+    if (fRewrite) {
+        // Erasures come first in the batch, the records written after them stay
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        for (char prefix : {DB_PRIVACY_SIGMA_SERIAL, DB_PRIVACY_SIGMA_GROUP}) {
+            pcursor->Seek(prefix);
+            char keyPrefix;
+            while (pcursor->Valid() && pcursor->GetKey(keyPrefix) && keyPrefix == prefix) {
+                std::pair<char, secp_primitives::Scalar> serialKey;
+                std::pair<char, std::pair<int, int>> groupKey;
+                if (prefix == DB_PRIVACY_SIGMA_SERIAL && pcursor->GetKey(serialKey))
+                    batch.Erase(serialKey);
+                else if (prefix == DB_PRIVACY_SIGMA_GROUP && pcursor->GetKey(groupKey))
+                    batch.Erase(groupKey);
+                else
+                    return error("%s: failed to read a Sigma state key", __func__);
+                pcursor->Next();
+            }
+        }
+    }
+
+    for (const std::pair<secp_primitives::Scalar, bool>& serial : serials) {
+        if (serial.second)
+            batch.Write(std::make_pair(DB_PRIVACY_SIGMA_SERIAL, serial.first), '1');
+        else
+            batch.Erase(std::make_pair(DB_PRIVACY_SIGMA_SERIAL, serial.first));
+    }
+    for (const std::pair<std::pair<int, int>, std::vector<unsigned char>>& group : groups) {
+        if (group.second.empty())
+            batch.Erase(std::make_pair(DB_PRIVACY_SIGMA_GROUP, group.first));
+        else
+            batch.Write(std::make_pair(DB_PRIVACY_SIGMA_GROUP, group.first), group.second);
+    }
+    batch.Write(DB_PRIVACY_SIGMA_STATE, snapshot);
+    return WriteBatch(batch);
+}
+
+bool CPrivacyIndexDB::Sync() {
+    // A synchronous write flushes the log along with every write before it
+    CDBBatch batch(*this);
+    return WriteBatch(batch, true);
+}
+
+void CPrivacyIndexDB::CacheBlockData(const uint256& hash, std::shared_ptr<const CBlockPrivacyData> data) {
+    AssertLockHeld(cs_cache);
+    auto it = cacheMap.find(hash);
+    if (it != cacheMap.end()) {
+        it->second->second = data;
+        cacheList.splice(cacheList.begin(), cacheList, it->second);
+        return;
+    }
+
+    cacheList.emplace_front(hash, data);
+    cacheMap.emplace(hash, cacheList.begin());
+    if (cacheList.size() > nPrivacyIndexCacheBlocks) {
+        cacheMap.erase(cacheList.back().first);
+        cacheList.pop_back();
+    }
+}
+
 namespace {
 
 //! Legacy class to deserialize pre-pertxout database entries without reindex.
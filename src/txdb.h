@@ -9,8 +9,11 @@
 #include <coins.h>
 #include <dbwrapper.h>
 #include <chain.h>
+#include <sync.h>
 
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -19,6 +22,7 @@
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CPrivacyIndexDB;
 class uint256;
 
 //! No need to periodic flush if at least this much space still available.
@@ -39,6 +43,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max memory allocated to privacy index DB specific cache (MiB)
+static const int64_t nMaxPrivacyIndexDBCache = 8;
+//! Number of blocks whose privacy data is kept in memory by the privacy index
+static const size_t nPrivacyIndexCacheBlocks = 2000;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -141,7 +149,73 @@ public:
 
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Load the block index and move the privacy data of records written by older releases to the privacy index.
+     * Marks the block index with a version that older releases refuse to load, they need -reindex after a downgrade.
+     */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, CPrivacyIndexDB& privacyIndex);
+};
+
+/** Transaction and block of a Sigma mint in the active chain */
+struct CSigmaMintLocator
+{
+    uint256 txHash;
+    uint256 blockHash;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txHash);
+        READWRITE(blockHash);
+    }
+};
+
+/** Access to the Zerocoin and Sigma data of blocks (blocks/privacy/), keyed by block height and hash,
+ *  to the locators of Sigma mints, keyed by GetPubCoinValueHash(), to the cached witnesses of Zerocoin coins
+ *  and to the last Sigma state snapshot.
+ *  The data of the most recently used blocks is kept in memory.
+ */
+class CPrivacyIndexDB : public CDBWrapper
+{
+public:
+    explicit CPrivacyIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    CPrivacyIndexDB(const CPrivacyIndexDB&) = delete;
+    CPrivacyIndexDB& operator=(const CPrivacyIndexDB&) = delete;
+
+    //! Privacy data of the block, empty if it has none
+    std::shared_ptr<const CBlockPrivacyData> ReadBlockData(const CBlockIndex* pindex);
+    bool WriteBlockData(const CBlockIndex* pindex, const CBlockPrivacyData& data);
+    bool ReadMintLocator(const uint256& pubCoinValueHash, CSigmaMintLocator& locator);
+    bool WriteMintLocators(const std::vector<std::pair<uint256, CSigmaMintLocator>>& locators);
+    //! Erase the locators that point to the block blockHash
+    bool EraseMintLocators(const std::vector<uint256>& pubCoinValueHashes, const uint256& blockHash);
+    bool ReadZerocoinWitness(const CZerocoinWitnessKey& key, CZerocoinWitnessRecord& record);
+    bool WriteZerocoinWitness(const CZerocoinWitnessKey& key, const CZerocoinWitnessRecord& record);
+    bool EraseZerocoinWitness(const CZerocoinWitnessKey& key);
+    //! Serialized Sigma state, see CSigmaState::WriteSnapshot(). The spent serials and the coin groups are records
+    //! of their own, so that a snapshot only writes what changed since the previous one
+    bool ReadSigmaStateSnapshot(std::vector<unsigned char>& snapshot, std::vector<secp_primitives::Scalar>& serials);
+    bool ReadSigmaCoinGroup(const std::pair<int, int>& group, std::vector<unsigned char>& data);
+    //! Write the snapshot in one batch with the serials spent (true) or no longer spent (false) and the coin groups
+    //! changed since the previous snapshot, empty data erases a group. fRewrite erases all the serials and coin
+    //! groups written before
+    bool WriteSigmaStateSnapshot(const std::vector<unsigned char>& snapshot,
+        const std::vector<std::pair<secp_primitives::Scalar, bool>>& serials,
+        const std::vector<std::pair<std::pair<int, int>, std::vector<unsigned char>>>& groups, bool fRewrite);
+    //! Make all the writes done so far durable
+    bool Sync();
+
+private:
+    typedef std::list<std::pair<uint256, std::shared_ptr<const CBlockPrivacyData>>> CacheList;
+
+    CCriticalSection cs_cache;
+    //! Most recently used first
+    CacheList cacheList;
+    std::map<uint256, CacheList::iterator> cacheMap;
+
+    void CacheBlockData(const uint256& hash, std::shared_ptr<const CBlockPrivacyData> data);
 };
 
 #endif // BITCOIN_TXDB_H
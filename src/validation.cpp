@@ -17,6 +17,7 @@
 #include <cuckoocache.h>
 #include <hash.h>
 #include <init.h>
+#include <parallel.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -351,6 +352,7 @@ bool fDataIndex = false;
 /*************************/
 
 uint256 hashAssumeValid;
+uint256 hashPrivacyAssumeValid;
 arith_uint256 nMinimumChainWork;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
@@ -410,6 +412,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
+std::unique_ptr<CPrivacyIndexDB> pprivacyindex;
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
@@ -771,7 +774,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
     }
     if (tx.IsSigmaSpend()) {
         for(int i = 0; i < tx.vin.size(); i++){
-            sSpendSerialBatch.push_back(SigmaGetSpendSerialNumber(tx, tx.vin[i]));
+            sSpendSerialBatch.push_back(SigmaGetSpendSerialNumber(tx, i));
             if (!sigmaState->CanAddSpendToMempool(sSpendSerialBatch[i])) {
                 LogPrintf("AcceptToMemoryPool(): serial number %s has been used\n", zcSpendSerialBatch[i].ToString());
                 return state.Invalid(false, REJECT_INVALID, "txn-mempool-conflict");
@@ -1187,9 +1190,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                 }
                 // add input denoms
                 for(int i = 0; i < tx.vin.size(); i++){
-                    std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                    newSpend = ParseSigmaSpend(tx.vin[i]);
-                    inVal += newSpend.first->getIntDenomination();
+                    inVal += GetSigmaSpend(tx, i)->getIntDenomination();
                 }
 
                 nFees = inVal - outVal;
@@ -2272,9 +2273,7 @@ bool GetGhostnodeFeePayment(int64_t &returnFee, bool &payFees, const CBlock &pBl
                     }
                     // add input denoms
                     for(int i = 0; i < ctx->vin.size(); i++){
-                        std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                        newSpend = ParseSigmaSpend(ctx->vin[i]);
-                        inVal += newSpend.first->getIntDenomination();
+                        inVal += GetSigmaSpend(*ctx, i)->getIntDenomination();
                     }
                     CAmount neededForFee = (inVal - outVal)/0.0025;
                     mintVector.push_back(neededForFee);
@@ -2307,9 +2306,7 @@ bool GetGhostnodeFeePayment(int64_t &returnFee, bool &payFees, const CBlock &pBl
                             }
                             // add input denoms
                             for(int i = 0; i < ctx->vin.size(); i++){
-                                std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                                newSpend = ParseSigmaSpend(ctx->vin[i]);
-                                inVal += newSpend.first->getIntDenomination();
+                                inVal += GetSigmaSpend(*ctx, i)->getIntDenomination();
                             }
                             CAmount neededForFee = (inVal - outVal)/0.0025;
                             mintVector.push_back(neededForFee);
@@ -2349,9 +2346,7 @@ bool GetGhostnodeFeePayment(int64_t &returnFee, bool &payFees, const CBlock &pBl
                     }
                     // add input denoms
                     for(int i = 0; i < ctx->vin.size(); i++){
-                        std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                        newSpend = ParseSigmaSpend(ctx->vin[i]);
-                        inVal += newSpend.first->getIntDenomination();
+                        inVal += GetSigmaSpend(*ctx, i)->getIntDenomination();
                     }
                     CAmount neededForFee = (inVal - outVal)/0.0025;
                     mintVector.push_back(neededForFee);
@@ -2704,9 +2699,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             }
             // add input denoms
             for(int i = 0; i < tx.vin.size(); i++){
-                std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                newSpend = ParseSigmaSpend(tx.vin[i]);
-                inVal += newSpend.first->getIntDenomination();
+                inVal += GetSigmaSpend(tx, i)->getIntDenomination();
             }
             nFees += (inVal - outVal);
         }
@@ -2930,12 +2923,21 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
+    ParallelExecutorStats parallelStats = GetParallelExecutorStats();
+    LogPrint(BCLog::BENCH, "    - Proof executor: %d workers, %u tasks queued, %u run, %u stolen\n", parallelStats.nWorkers,
+        parallelStats.nQueued, parallelStats.nTasks, parallelStats.nSteals);
 
 
-    if (!ConnectBlockGhost(state, chainparams, pindex, &block))
+    // The privacy index gets the mints and spends of the block only once it is connected for real
+    CBlockPrivacyData privacyData;
+    if (pindex->phashBlock)
+        privacyData = *pprivacyindex->ReadBlockData(pindex);
+    bool fHadPrivacyData = !privacyData.IsNull();
+
+    if (!ConnectBlockGhost(state, chainparams, pindex, &block, privacyData, fJustCheck))
         return false;
 
-    if (!ConnectBlockSigma(state, chainparams, pindex, &block))
+    if (!ConnectBlockSigma(state, chainparams, pindex, &block, privacyData, fJustCheck))
         return false;
 
     //Set money supply on block once PoS starts, calculate previous total
@@ -2960,6 +2962,20 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
+    if ((fHadPrivacyData || !privacyData.IsNull()) && !pprivacyindex->WriteBlockData(pindex, privacyData))
+        return AbortNode(state, "Failed to write privacy index");
+
+    if (block.sigmaTxInfo && !block.sigmaTxInfo->mintTxHashes.empty()) {
+        std::vector<std::pair<uint256, CSigmaMintLocator>> mintLocators;
+        for (const std::pair<GroupElement, uint256>& mint : block.sigmaTxInfo->mintTxHashes)
+            mintLocators.push_back(std::make_pair(GetPubCoinValueHash(mint.first), CSigmaMintLocator{mint.second, blockHash}));
+        if (!pprivacyindex->WriteMintLocators(mintLocators))
+            return AbortNode(state, "Failed to write mint locators");
+    }
+
+    // Cached Zerocoin witnesses follow the block only once it passed every check
+    CZerocoinState::GetZerocoinState()->UpdateCoinWitnesses(pindex, privacyData);
+
     if (!WriteTxIndexDataForBlock(block, state, pindex))
         return false;
 
@@ -3096,6 +3112,9 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 return state.Error("out of disk space");
             // First make sure all block and undo data is flushed to disk.
             FlushBlockFile();
+            // The privacy data of connected blocks too, the chain state below may refer to it.
+            if (!pprivacyindex->Sync())
+                return AbortNode(state, "Failed to write to privacy index database");
             // Then update all block file information (which may refer to block and undo files).
             {
                 std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
@@ -3131,6 +3150,10 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // Let the next start load the Sigma state instead of replaying the chain. It is only a shortcut,
+            // a missing or stale snapshot just means a longer replay
+            if (!CSigmaState::GetSigmaState()->WriteSnapshot(chainActive.Tip()))
+                LogPrintf("%s: failed to write the Sigma state snapshot\n", __func__);
             nLastFlush = nNow;
         }
     }
@@ -4155,6 +4178,27 @@ bool CheckStakeUnique(const CBlock &block, bool fUpdate)
     return AddToMapStakeSeen(kernel, blockHash);
 }
 
+bool IsPrivacyProofAssumedValid(const CBlock& block, int nHeight)
+{
+    if (hashPrivacyAssumeValid.IsNull() || nHeight == INT_MAX)
+        return false;
+
+    LOCK(cs_main);
+    BlockMap::const_iterator it = mapBlockIndex.find(hashPrivacyAssumeValid);
+    if (it == mapBlockIndex.end() || pindexBestHeader == nullptr || it->second->nHeight < nHeight)
+        return false;
+
+    // Same conditions as the script checks skipped under -assumevalid: the block is an ancestor of the anchor, the
+    // anchor one of a best header with the minimum chain work, and the block is buried for more than two weeks
+    const CBlockIndex* pindexAnchor = it->second;
+    const CBlockIndex* pindex = pindexAnchor->GetAncestor(nHeight);
+    if (pindex == nullptr || pindex->GetBlockHash() != block.GetHash())
+        return false;
+    if (pindexBestHeader->GetAncestor(pindexAnchor->nHeight) != pindexAnchor || pindexBestHeader->nChainWork < nMinimumChainWork)
+        return false;
+    return GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, Params().GetConsensus()) > 60 * 60 * 24 * 7 * 2;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, int nHeight, bool isVerifyDB)
 {
     // These are checks that are independent of context.
@@ -4238,6 +4282,9 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (block.sigmaTxInfo == NULL)
         block.sigmaTxInfo = std::make_shared<CSigmaTxInfo>();
 
+    block.zerocoinTxInfo->fAssumeValidProofs = !isVerifyDB && IsPrivacyProofAssumedValid(block, nHeight);
+    block.zerocoinTxInfo->nSkippedProofs = 0;
+
     // Check transactions
     for (const auto& tx : block.vtx){
         if (!CheckTransaction(*tx, state, tx->GetHash(), isVerifyDB, true, nHeight, false, block.zerocoinTxInfo.get(), block.sigmaTxInfo.get())){
@@ -4246,6 +4293,11 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         }
     }
 
+    // Sigma proofs of the block are verified in batches after all the transactions have been seen
+    if (!CheckSigmaBlockSpends(state, block.sigmaTxInfo.get(), nHeight))
+        return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                             strprintf("Sigma spend check failed %s", state.GetDebugMessage()));
+
     block.zerocoinTxInfo->Complete();
     block.sigmaTxInfo->Complete();
 
@@ -5005,7 +5057,7 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 
 bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash){ return this->InsertBlockIndex(hash); }))
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash){ return this->InsertBlockIndex(hash); }, *pprivacyindex))
         return false;
 
     boost::this_thread::interruption_point();
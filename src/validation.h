@@ -36,6 +36,7 @@
 class CBlockIndex;
 class CBlockTreeDB;
 class CChainParams;
+class CPrivacyIndexDB;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -84,6 +85,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads used by one Sigma multi-exponentiation */
+static const int MAX_SIGMA_VERIFY_THREADS = 16;
+/** -sigmaverifythreads default (number of Sigma multi-exponentiation threads, 0 = auto) */
+static const int DEFAULT_SIGMA_VERIFY_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer (x4 from btc). */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16 * TIME_MULTIPLIER;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -235,6 +240,9 @@ extern bool fEnableReplacement;
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
 
+/** Block hash whose ancestors we will assume to have valid Zerocoin spend proofs without checking them. */
+extern uint256 hashPrivacyAssumeValid;
+
 /** Minimum work we will assume exists on some valid chain. */
 extern arith_uint256 nMinimumChainWork;
 
@@ -476,6 +484,9 @@ bool GetGhostnodeFeePayment(int64_t &returnFee, bool &payFees, const CBlock &pBl
 /** Context-independent validity checks */
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, int nHeight = INT_MAX, bool isVerifyDB = false);
 
+/** Whether the block at nHeight is buried under hashPrivacyAssumeValid, so its Zerocoin spend proofs need no verification */
+bool IsPrivacyProofAssumedValid(const CBlock& block, int nHeight);
+
 /** Check a block is completely valid from start to finish (only works on top of our current best block, with cs_main held) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
 
@@ -526,6 +537,9 @@ extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern std::unique_ptr<CBlockTreeDB> pblocktree;
 
+/** Global variable that points to the Zerocoin and Sigma data of blocks (has its own lock) */
+extern std::unique_ptr<CPrivacyIndexDB> pprivacyindex;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
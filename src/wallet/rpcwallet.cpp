@@ -21,6 +21,7 @@
 #include <rpc/util.h>
 #include <script/sign.h>
 #include <timedata.h>
+#include <txdb.h>
 #include <util.h>
 #include <utilmoneystr.h>
 #include <wallet/coincontrol.h>
@@ -5396,7 +5397,8 @@ UniValue listallserials(const JSONRPCRequest& request)
     UniValue results(UniValue::VARR);
     if(request.params.size() > 0){
         CBlockIndex *temp = chainActive[request.params[0].get_int()];
-        for(auto it = temp->spentSerials.begin(); it != temp->spentSerials.end(); it++){
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(temp);
+        for(auto it = blockData->spentSerials.begin(); it != blockData->spentSerials.end(); it++){
             results.push_back(it->ToString());
         }
         return results;
@@ -5405,7 +5407,8 @@ UniValue listallserials(const JSONRPCRequest& request)
 
     for(auto it = 53000; it <= chainActive.Tip()->nHeight; it++){
         CBlockIndex *temp = chainActive[it];
-        for(auto it = temp->spentSerials.begin(); it != temp->spentSerials.end(); it++){
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(temp);
+        for(auto it = blockData->spentSerials.begin(); it != blockData->spentSerials.end(); it++){
             results.push_back(it->ToString());
         }
     }
@@ -5604,9 +5607,7 @@ UniValue ghostfeepayouttotal(const JSONRPCRequest& request)
                     }
                     // add input denoms
                     for(int k = 0; k < ctx->vin.size(); k++){
-                        std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                        newSpend = ParseSigmaSpend(ctx->vin[k]);
-                        inVal += newSpend.first->getIntDenomination();
+                        inVal += GetSigmaSpend(*ctx, k)->getIntDenomination();
                     }
                     CAmount neededForFee = (inVal - outVal)/0.0025;
                     mintVector.push_back(neededForFee);
@@ -31,7 +31,7 @@
 #include <wallet/fees.h>
 #include <utilstrencodings.h>
 #include <assert.h>
-#include <future>
+#include <parallel.h>
 #include <rpc/protocol.h>
 #include "ghostnode/activeghostnode.h"
 #include "ghostnode/darksend.h"
@@ -1362,9 +1362,9 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             }
             else if (wtx.tx->IsSigmaSpend()) {
                 // find out coin serial number
-                for(const CTxIn &txin: wtx.tx->vin){
+                for(unsigned int i = 0; i < wtx.tx->vin.size(); i++){
                     CSigmaSpendEntry entry;
-                    Scalar serial = SigmaGetSpendSerialNumber(*wtx.tx, txin);
+                    Scalar serial = SigmaGetSpendSerialNumber(*wtx.tx, i);
                     if (!CWalletDB(*dbw).ReadSigmaSpendEntry(serial, entry)) {
                         return false;
                         LogPrintf("\CWallet::AbandonTransaction(): It cannot read sigma coin serial number in wallet.\n");
@@ -8817,9 +8817,7 @@ bool CWallet::SignBlock(CBlockTemplate *pblocktemplate, int nHeight, int64_t nSe
                 }
                 // add input denoms
                 for(int k = 0; k < pblock->vtx[i]->vin.size(); k++){
-                    std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> newSpend;
-                    newSpend = ParseSigmaSpend(pblock->vtx[i]->vin[k]);
-                    inVal += newSpend.first->getIntDenomination();
+                    inVal += GetSigmaSpend(*pblock->vtx[i], k)->getIntDenomination();
                 }
                 nGhostFees += inVal - outVal;
 
@@ -9572,135 +9570,171 @@ bool CWallet::CreateSigmaSpendTransaction(std::string &toKey, vector <CScript> p
     CSigmaState *sigmaState = CSigmaState::GetSigmaState();
     sigma::Params* sParams = SParams;
 
-    std::vector<std::vector<sigma::PublicCoin>> anonimity_set_batch;
+    // Anonymity sets of the spends, the views keep their coins so that proving needs no locks
+    std::vector<sigma::AnonymitySetView> anonimity_set_batch;
 
     uint256 blockHash;
 
     std::vector<int> serializedId;
-    for(int i = 0; i < nValueBatch.size(); i++){
+    {
+        // Coins and their anonymity sets are selected under the locks, the views of the sets taken
+        // here are all that proving needs afterwards
+        LOCK2(cs_main, cs_wallet);
+        for(int i = 0; i < nValueBatch.size(); i++){
 
-        int coinId = INT_MAX;
-        int coinHeight;
-        int coinGroupID;
+            int coinId = INT_MAX;
+            int coinHeight;
+            int coinGroupID;
 
-        // Get Mint metadata objects
-        vector<CMintMeta> setMints;
-        setMints = sigmaTracker->ListMints(true, true, true);
-        if(setMints.empty()) {
-            strFailReason= _("Failed to find sigma coins in wallet.dat");
-            return false;
-        }
+            // Get Mint metadata objects
+            vector<CMintMeta> setMints;
+            setMints = sigmaTracker->ListMints(true, true, true);
+            if(setMints.empty()) {
+                strFailReason= _("Failed to find sigma coins in wallet.dat");
+                return false;
+            }
 
-        CSigmaEntry coinToUse;
-        std::vector<sigma::PublicCoin> anonimity_set;
-        // Cycle through metadata, looking for suitable coin
-        list<CMintMeta> listMints(setMints.begin(), setMints.end());
-        for (const CMintMeta& mint : listMints) {
-            bool coinUsed = false;
+            CSigmaEntry coinToUse;
+            sigma::AnonymitySetView anonimity_set;
+            // Cycle through metadata, looking for suitable coin
+            list<CMintMeta> listMints(setMints.begin(), setMints.end());
+            for (const CMintMeta& mint : listMints) {
+                bool coinUsed = false;
 
-            for(auto coin: coinToUseBatch)
-                if(mint.pubCoinValue == coin.value)
-                    coinUsed = true;
+                for(auto coin: coinToUseBatch)
+                    if(mint.pubCoinValue == coin.value)
+                        coinUsed = true;
 
-            if (denominationBatch[i] == mint.denom && ((mint.isUsed == false && !forceUsed) || (mint.isUsed == true && forceUsed)) && !coinUsed)
-            {
+                if (denominationBatch[i] == mint.denom && ((mint.isUsed == false && !forceUsed) || (mint.isUsed == true && forceUsed)) && !coinUsed)
+                {
 
-                if (!GetMint(mint.hashSerial, coinToUse) && !forceUsed) {
-                    strFailReason = "Failed to fetch hashSerial " + mint.hashSerial.GetHex();
-                    return false;
-                }
+                    if (!GetMint(mint.hashSerial, coinToUse) && !forceUsed) {
+                        strFailReason = "Failed to fetch hashSerial " + mint.hashSerial.GetHex();
+                        return false;
+                    }
 
-                std::pair<int, int> coinHeightAndId = sigmaState->GetMintedCoinHeightAndId(
-                            sigma::PublicCoin(coinToUse.value, denominationBatch[i]));
-
-                coinHeight = coinHeightAndId.first;
-                coinGroupID = coinHeightAndId.second;
-
-                if (coinHeight > 0
-                        && coinGroupID < coinId // Always spend coin with smallest ID that matches.
-                        && coinHeight + (ZEROCOIN_CONFIRM_HEIGHT) <= chainActive.Height()
-                        && sigmaState->GetCoinSetForSpend(
-                            &chainActive,
-                            chainActive.Height()-(ZEROCOIN_CONFIRM_HEIGHT),
-                            denominationBatch[i],
-                            coinGroupID,
-                            blockHash,
-                            anonimity_set) > 1 )  {
-                    coinId = coinGroupID;
-                    break;
+                    std::pair<int, int> coinHeightAndId = sigmaState->GetMintedCoinHeightAndId(
+                                sigma::PublicCoin(coinToUse.value, denominationBatch[i]));
+
+                    coinHeight = coinHeightAndId.first;
+                    coinGroupID = coinHeightAndId.second;
+
+                    if (coinHeight > 0
+                            && coinGroupID < coinId // Always spend coin with smallest ID that matches.
+                            && coinHeight + (ZEROCOIN_CONFIRM_HEIGHT) <= chainActive.Height()
+                            && sigmaState->GetCoinSetForSpend(
+                                &chainActive,
+                                chainActive.Height()-(ZEROCOIN_CONFIRM_HEIGHT),
+                                denominationBatch[i],
+                                coinGroupID,
+                                blockHash,
+                                anonimity_set) > 1 )  {
+                        coinId = coinGroupID;
+                        break;
+                    }
                 }
             }
-        }
 
-        if (coinId == INT_MAX) {
-            strFailReason = _("not enough coins in accumulator");
-            return false;
-        }
+            if (coinId == INT_MAX) {
+                strFailReason = _("not enough coins in accumulator");
+                return false;
+            }
 
 
-        coinToUseBatch.push_back(coinToUse);
-        txHashBatch.push_back(blockHash);
-        anonimity_set_batch.push_back(anonimity_set);
-        CTxIn newTxIn;
-        newTxIn.scriptSig = CScript();
-        newTxIn.prevout.n = coinId;
-        txNew.vin.push_back(newTxIn);
-        txNewTemp.vin.push_back(newTxIn);
-        serializedId.push_back(coinId);
+            coinToUseBatch.push_back(coinToUse);
+            txHashBatch.push_back(blockHash);
+            anonimity_set_batch.push_back(anonimity_set);
+            CTxIn newTxIn;
+            newTxIn.scriptSig = CScript();
+            newTxIn.prevout.n = coinId;
+            txNew.vin.push_back(newTxIn);
+            txNewTemp.vin.push_back(newTxIn);
+            serializedId.push_back(coinId);
+        }
     }
 
-    for(int i = 0; i < nValueBatch.size(); i++){
-        {
-            LOCK2(cs_main, cs_wallet);
-            {
+    int txVersion = sigma::SIGMA_VERSION_2;
 
-                // We use incomplete transaction hash as metadata.
-                sigma::SpendMetaData metaData(serializedId[i], txHashBatch[i], txNewTemp.GetHash());
+    // We use incomplete transaction hash as metadata.
+    uint256 txHashForMetadata = txNewTemp.GetHash();
+    LogPrintf("CreateSigmaSpendTransation: tx version=%d, tx metadata hash=%s\n", txVersion, txHashForMetadata.ToString());
 
-                // Construct the CoinSpend object. This acts like a signature on the
-                // transaction.
-                sigma::PrivateCoin privateCoin(sParams, denominationBatch[i]);
+    std::vector<sigma::PrivateCoin> privateCoinBatch;
+    std::vector<sigma::SpendMetaData> metaDataBatch;
+    for(int i = 0; i < nValueBatch.size(); i++){
+        // 2. Get pubcoin from the private coin
+        sigma::PublicCoin pubCoinSelected(coinToUseBatch[i].value, denominationBatch[i]);
 
-                int txVersion = sigma::SIGMA_VERSION_2;
+        // Now make sure the coin is valid.
+        if (!pubCoinSelected.validate()) {
+            strFailReason = _("the selected sigma mint is an invalid coin");
+            return false;
+        }
 
-                LogPrintf("CreateSigmaSpendTransation: tx version=%d, tx metadata hash=%s\n", txVersion, txNew.GetHash().ToString());
+        sigma::PrivateCoin privateCoin(sParams, denominationBatch[i]);
+        privateCoin.setVersion(txVersion);
+        privateCoin.setPublicCoin(pubCoinSelected);
+        privateCoin.setRandomness(coinToUseBatch[i].randomness);
+        privateCoin.setSerialNumber(coinToUseBatch[i].serialNumber);
+        privateCoin.setEcdsaSeckey(coinToUseBatch[i].ecdsaSecretKey);
 
-                // 2. Get pubcoin from the private coin
-                sigma::PublicCoin pubCoinSelected(coinToUseBatch[i].value, denominationBatch[i]);
+        privateCoinBatch.push_back(privateCoin);
+        metaDataBatch.push_back(sigma::SpendMetaData(serializedId[i], txHashBatch[i], txHashForMetadata));
+    }
 
-                // Now make sure the coin is valid.
-                if (!pubCoinSelected.validate()) {
-                    strFailReason = _("the selected sigma mint is an invalid coin");
-                    return false;
-                }
+    // Construct the CoinSpend objects, one proof per input in parallel. They act like a signature
+    // on the transaction. No locks are held, so RPC and staking are not blocked while proving.
+    std::vector<std::unique_ptr<sigma::CoinSpend>> spendBatch(nValueBatch.size());
+    ParallelFor(spendBatch.size(), 1, [&](size_t i) {
+        try {
+            spendBatch[i].reset(new sigma::CoinSpend(sParams, privateCoinBatch[i], anonimity_set_batch[i], metaDataBatch[i], true));
+            spendBatch[i]->setVersion(txVersion);
+        } catch (const std::exception &e) {
+            LogPrintf("CreateSigmaSpendTransaction: failed to create sigma proof: %s\n", e.what());
+        }
+    });
 
-                privateCoin.setVersion(txVersion);
-                privateCoin.setPublicCoin(pubCoinSelected);
-                privateCoin.setRandomness(coinToUseBatch[i].randomness);
-                privateCoin.setSerialNumber(coinToUseBatch[i].serialNumber);
-                privateCoin.setEcdsaSeckey(coinToUseBatch[i].ecdsaSecretKey);
+    // This is a sanity check. The CoinSpend objects should always verify, but why not check before
+    // we put them onto the wire? Spends of one coin group are verified together.
+    std::map<std::pair<sigma::CoinDenomination, int>, std::vector<int>> spendsByGroup;
+    for(int i = 0; i < nValueBatch.size(); i++){
+        if (!spendBatch[i] || !spendBatch[i]->HasValidSignature(metaDataBatch[i])) {
+            strFailReason = _("the sigma spend coin transaction did not verify");
+            return false;
+        }
+        spendsByGroup[std::make_pair(denominationBatch[i], serializedId[i])].push_back(i);
+    }
 
-                sigma::CoinSpend spend(sParams, privateCoin, anonimity_set_batch[i], metaData, true);
-                spend.setVersion(txVersion);
+    for (const auto &group : spendsByGroup) {
+        // Anonymity sets of a group only differ in how many of the latest coins they include
+        sigma::AnonymitySetView anonimity_set = anonimity_set_batch[group.second[0]];
+        for (int i : group.second)
+            if (anonimity_set_batch[i].size() > anonimity_set.size())
+                anonimity_set = anonimity_set_batch[i];
 
-                // This is a sanity check. The CoinSpend object should always verify,
-                // but why not check before we put it onto the wire?
-                if (!spend.Verify(anonimity_set_batch[i], metaData, true)) {
-                    strFailReason = _("the sigma spend coin transaction did not verify");
-                    return false;
-                }
+        std::vector<const sigma::CoinSpend *> spends;
+        std::vector<std::size_t> setSizes;
+        for (int i : group.second) {
+            spends.push_back(spendBatch[i].get());
+            setSizes.push_back(anonimity_set_batch[i].size());
+        }
 
-                coinSerialBatch.push_back(spend.getCoinSerialNumber());
-                // Serialize the CoinSpend object into a buffer.
-                CDataStream serializedCoinSpend(SER_NETWORK, PROTOCOL_VERSION);
-                serializedCoinSpend << spend;
+        if (!sigma::CoinSpend::BatchVerify(sParams, anonimity_set, spends, setSizes, std::vector<bool>(spends.size(), true))) {
+            strFailReason = _("the sigma spend coin transaction did not verify");
+            return false;
+        }
+    }
 
-                CScript tmp = CScript() << OP_SIGMASPEND; //<< serializedCoinSpend.size();
+    for(int i = 0; i < nValueBatch.size(); i++){
+        coinSerialBatch.push_back(spendBatch[i]->getCoinSerialNumber());
+        // Serialize the CoinSpend object into a buffer.
+        CDataStream serializedCoinSpend(SER_NETWORK, PROTOCOL_VERSION);
+        serializedCoinSpend << *spendBatch[i];
 
-                tmp.insert(tmp.end(), serializedCoinSpend.begin(), serializedCoinSpend.end());
-                txNew.vin[i].scriptSig.assign(tmp.begin(), tmp.end());
-            }
-        }
+        CScript tmp = CScript() << OP_SIGMASPEND; //<< serializedCoinSpend.size();
+
+        tmp.insert(tmp.end(), serializedCoinSpend.begin(), serializedCoinSpend.end());
+        txNew.vin[i].scriptSig.assign(tmp.begin(), tmp.end());
     }
 
     // Embed the constructed transaction data in wtxNew.
@@ -10,15 +10,135 @@
 #include <wallet/wallet.h>
 #include <wallet/walletdb.h>
 #include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <sstream>
 #include <chrono>
 #include <net_processing.h>
 #include <utilstrencodings.h>
+#include <cuckoocache.h>
+#include <crypto/sha256.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <txdb.h>
+#include <checkqueue.h>
+#include <boost/thread.hpp>
 
 sigma::Params* SParams = sigma::Params::get_default();
 
 static CSigmaState sigmaState;
 
+// Format of the snapshots written by CSigmaState::WriteSnapshot()
+static const int SIGMA_STATE_SNAPSHOT_VERSION = 3;
+
+namespace {
+/**
+ * Sigma proofs that are known to be valid, so that a spend verified when it entered the mempool
+ * is not verified again when the block containing it is checked.
+ */
+class CSigmaProofCache
+{
+private:
+    //! Entries are SHA256(nonce || spend script || denomination || coin group id ||
+    //! anonymity set block hash || metadata hash)
+    uint256 nonce;
+    CuckooCache::cache<uint256, SignatureCacheHasher> setValid;
+    boost::shared_mutex cs_proofcache;
+
+public:
+    CSigmaProofCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    // The anonymity set is fully determined by the coin group and the block it ends at
+    void ComputeEntry(uint256& entry, const CScript& scriptSig, sigma::CoinDenomination denomination,
+            int coinGroupId, const uint256& setBlockHash, const sigma::SpendMetaData& metaData)
+    {
+        int64_t nDenomination = (int64_t)denomination;
+        int64_t nCoinGroupId = coinGroupId;
+        uint256 metaDataHash = SerializeHash(metaData);
+        CSHA256().Write(nonce.begin(), 32)
+            .Write(scriptSig.data(), scriptSig.size())
+            .Write((const unsigned char *)&nDenomination, sizeof(nDenomination))
+            .Write((const unsigned char *)&nCoinGroupId, sizeof(nCoinGroupId))
+            .Write(setBlockHash.begin(), 32)
+            .Write(metaDataHash.begin(), 32)
+            .Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(const uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CSigmaProofCache sigmaProofCache;
+
+/**
+ * Spends parsed from the inputs of recent transactions, keyed by transaction hash and input index.
+ * The transaction hash commits to the scriptSig, so an entry never goes stale.
+ */
+class CSigmaSpendCache
+{
+private:
+    typedef std::pair<uint256, uint32_t> Key;
+    typedef std::list<std::pair<Key, std::shared_ptr<const sigma::CoinSpend>>> EntryList;
+
+    std::mutex cs_spendcache;
+    //! Most recently used first
+    EntryList entries;
+    std::map<Key, EntryList::iterator> entryMap;
+
+public:
+    std::shared_ptr<const sigma::CoinSpend> Get(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(cs_spendcache);
+        auto it = entryMap.find(key);
+        if (it == entryMap.end())
+            return nullptr;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    void Set(const Key& key, std::shared_ptr<const sigma::CoinSpend> spend)
+    {
+        std::lock_guard<std::mutex> lock(cs_spendcache);
+        if (entryMap.count(key))
+            return;
+        entries.emplace_front(key, std::move(spend));
+        entryMap[key] = entries.begin();
+        if (entries.size() > SIGMA_SPEND_CACHE_ENTRIES) {
+            entryMap.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+static CSigmaSpendCache sigmaSpendCache;
+} // namespace
+
+void InitSigmaProofCache()
+{
+    size_t nElems = sigmaProofCache.setup_bytes(SIGMA_PROOF_CACHE_SIZE);
+    LogPrintf("Using %zu MiB for sigma proof cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >> 20, nElems);
+}
+
 uint256 GetSerialHash(const Scalar& bnSerial)
 {
     CDataStream ss(SER_GETHASH, 0);
@@ -99,6 +219,28 @@ std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> ParseSigmaSpend(const CTx
     return std::make_pair(std::move(spend), groupId);
 }
 
+std::shared_ptr<const sigma::CoinSpend> GetSigmaSpend(const CTransaction& tx, unsigned int nIn)
+{
+    const CTxIn& in = tx.vin[nIn];
+    if (in.scriptSig.size() < 1) {
+        throw CBadTxIn();
+    }
+
+    std::pair<uint256, uint32_t> key(tx.GetHash(), nIn);
+    std::shared_ptr<const sigma::CoinSpend> spend = sigmaSpendCache.Get(key);
+    if (!spend) {
+        CDataStream serialized(
+            (const char *)&*(in.scriptSig.begin() + 1),
+            (const char *)&*in.scriptSig.end(),
+            SER_NETWORK,
+            PROTOCOL_VERSION
+        );
+        spend = std::make_shared<sigma::CoinSpend>(SParams, serialized);
+        sigmaSpendCache.Set(key, spend);
+    }
+    return spend;
+}
+
 bool CheckSigmaSpendTransaction(
         const CTransaction &tx,
         const vector<sigma::CoinDenomination>& targetDenominations,
@@ -113,10 +255,22 @@ bool CheckSigmaSpendTransaction(
     int vinIndex = -1;
     std::unordered_set<Scalar, sigma::CScalarHash> spendSerials;
 
+    // Obtain the hash of the transaction sans the sigma part, the metadata of all its spends
+    CMutableTransaction txTemp = tx;
+    for(CTxIn &txTempIn: txTemp.vin) {
+        if (txTempIn.scriptSig.IsSigmaSpend()) {
+            txTempIn.scriptSig.clear();
+        }
+    }
+    uint256 txHashForMetadata = txTemp.GetHash();
+
+    // Anonymity sets by coin group and block they end at, the spends of a transaction usually share them
+    std::map<std::tuple<sigma::CoinDenomination, int, uint256>, std::pair<sigma::AnonymitySetView, CBlockIndex *>> anonymitySets;
+
     for (const CTxIn &txin : tx.vin)
     {
-        std::unique_ptr<sigma::CoinSpend> spend;
-        uint32_t pubcoinId;
+        std::shared_ptr<const sigma::CoinSpend> spend;
+        uint32_t pubcoinId = txin.prevout.n;
 
         vinIndex++;
         if (txin.scriptSig.IsSigmaSpend())
@@ -125,7 +279,9 @@ bool CheckSigmaSpendTransaction(
             hasNonSigmaInputs = true;
 
         try {
-            std::tie(spend, pubcoinId) = ParseSigmaSpend(txin);
+            if (pubcoinId < 1 || pubcoinId >= INT_MAX)
+                throw CBadTxIn();
+            spend = GetSigmaSpend(tx, vinIndex);
         } catch (CBadTxIn&) {
             return state.DoS(100,
                 false,
@@ -140,26 +296,12 @@ bool CheckSigmaSpendTransaction(
                              "CTransaction::CheckTransaction() : Error: incorrect spend transaction version");
         }
 
-        uint256 txHashForMetadata;
-
-        // Obtain the hash of the transaction sans the sigma part
-        CMutableTransaction txTemp = tx;
-        for(CTxIn &txTempIn: txTemp.vin) {
-            if (txTempIn.scriptSig.IsSigmaSpend()) {
-                txTempIn.scriptSig.clear();
-            }
-        }
-        txHashForMetadata = txTemp.GetHash();
-
         CSigmaState::CoinGroupInfo coinGroup;
         if (!sigmaState.GetCoinGroupInfo(targetDenominations[vinIndex], pubcoinId, coinGroup))
             return state.DoS(100, false, NO_MINT_ZEROCOIN,
                     "CheckSigmaSpendTransaction: Error: no coins were minted with such parameters");
 
         bool passVerify = false;
-        CBlockIndex *index = coinGroup.lastBlock;
-        pair<sigma::CoinDenomination, int> denominationAndId = std::make_pair(
-            targetDenominations[vinIndex], pubcoinId);
 
         uint256 accumulatorBlockHash = spend->getAccumulatorBlockHash();
 
@@ -169,23 +311,6 @@ bool CheckSigmaSpendTransaction(
             accumulatorBlockHash,
             txHashForMetadata);
 
-        // find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
-        while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
-            index = index->pprev;
-
-        // Build a vector with all the public coins with given denomination and accumulator id before
-        // the block on which the spend occured.
-        // This list of public coins is required by function "Verify" of CoinSpend.
-        std::vector<sigma::PublicCoin> anonymity_set;
-        while(true) {
-            for(const sigma::PublicCoin& pubCoinValue: index->mintedPubCoinsV2[denominationAndId]) {
-                anonymity_set.push_back(pubCoinValue);
-            }
-            if (index == coinGroup.firstBlock)
-                break;
-            index = index->pprev;
-        }
-
         bool fPadding = spend->getVersion() >= sigma::SIGMA_VERSION_2;
         // require version 2 right away on full sync
         if (!isVerifyDB) {
@@ -197,7 +322,46 @@ bool CheckSigmaSpendTransaction(
             }
         }
 
-        passVerify = spend->Verify(anonymity_set, newMetaData, fPadding);
+        auto setKey = std::make_tuple(targetDenominations[vinIndex], (int)pubcoinId, accumulatorBlockHash);
+        auto setIt = anonymitySets.find(setKey);
+        if (setIt == anonymitySets.end()) {
+            CBlockIndex *setBlock;
+            sigma::AnonymitySetView set = sigmaState.GetAnonymitySet(
+                targetDenominations[vinIndex], pubcoinId, accumulatorBlockHash, &setBlock);
+            setIt = anonymitySets.emplace(setKey, std::make_pair(set, setBlock)).first;
+        }
+        const sigma::AnonymitySetView &anonymity_set = setIt->second.first;
+        CBlockIndex *setBlock = setIt->second.second;
+        uint256 cacheEntry;
+        sigmaProofCache.ComputeEntry(cacheEntry, txin.scriptSig, targetDenominations[vinIndex],
+            pubcoinId, setBlock->GetBlockHash(), newMetaData);
+
+        if (sigmaProofCache.Get(cacheEntry)) {
+            // Already verified, most likely when the transaction entered the mempool
+            passVerify = true;
+        }
+        else if (sigmaTxInfo && !sigmaTxInfo->fInfoIsComplete && !isCheckWallet) {
+            // We are checking a block. Sigma proof is verified later together with all the other
+            // spends of this coin group in the block, see CheckSigmaBlockSpends()
+            passVerify = spend->HasValidSignature(newMetaData);
+            if (passVerify) {
+                CSigmaTxInfo::CPendingSpend pending;
+                pending.spend = spend;
+                pending.denomination = targetDenominations[vinIndex];
+                pending.coinGroupId = pubcoinId;
+                pending.fPadding = fPadding;
+                pending.txHash = hashTx;
+                sigmaTxInfo->pendingSpends.push_back(pending);
+            }
+        }
+        else {
+            // anonymity_set holds all the public coins with given denomination and accumulator id
+            // minted before the block on which the spend occured.
+            passVerify = spend->Verify(anonymity_set, newMetaData, fPadding);
+            if (passVerify)
+                sigmaProofCache.Set(cacheEntry);
+        }
+
         if (passVerify) {
             Scalar serial = spend->getCoinSerialNumber();
             // do not check for duplicates in case we've seen exact copy of this tx in this block before
@@ -298,6 +462,7 @@ bool CheckSigmaMintTransaction(
     if (sigmaTxInfo != NULL && !sigmaTxInfo->fInfoIsComplete) {
         // Update public coin list in the info
         sigmaTxInfo->mints.push_back(pubCoin);
+        sigmaTxInfo->mintTxHashes.push_back(std::make_pair(pubCoinValue, hashTx));
         sigmaTxInfo->sTransactions.insert(hashTx);
     }
 
@@ -340,7 +505,8 @@ bool CheckSigmaTransaction(
     if(tx.IsSigmaSpend()) {
         vector<sigma::CoinDenomination> denominations;
         uint64_t totalValue = 0;
-        for(const CTxIn &txin: tx.vin){
+        for(unsigned int i = 0; i < tx.vin.size(); i++){
+            const CTxIn &txin = tx.vin[i];
             if(!txin.scriptSig.IsSigmaSpend()) {
                 return state.DoS(100, false,
                                  REJECT_MALFORMED,
@@ -353,11 +519,7 @@ bool CheckSigmaTransaction(
                 return false;
             }
 
-            CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 1),
-                                            (const char *)&*txin.scriptSig.end(),
-                                            SER_NETWORK, PROTOCOL_VERSION);
-            sigma::CoinSpend newSpend(SParams, serializedCoinSpend);
-            uint64_t denom = newSpend.getIntDenomination();
+            uint64_t denom = GetSigmaSpend(tx, i)->getIntDenomination();
             totalValue += denom;
             sigma::CoinDenomination denomination;
             if (!sigma::IntegerToDenomination(denom, denomination, state))
@@ -379,25 +541,133 @@ bool CheckSigmaTransaction(
     return true;
 }
 
+static CCheckQueue<CSigmaSpendCheck> sigmaSpendCheckQueue(1);
+
+void ThreadSigmaSpendCheck() {
+    RenameThread("nix-sigmach");
+    sigmaSpendCheckQueue.Thread();
+}
+
+void CSigmaSpendCheck::AddSpend(const sigma::CoinSpend *spend, std::size_t setSize, bool fPaddingIn, const uint256 &txHash) {
+    // Anonymity set of an earlier block is a prefix of the one of a later block, the set of the check
+    // covers the spends over any of them
+    assert(setSize <= anonymitySet.size());
+    spends.push_back(spend);
+    setSizes.push_back(setSize);
+    fPadding.push_back(fPaddingIn);
+    txHashes.push_back(txHash);
+}
+
+bool CSigmaSpendCheck::operator()() {
+    if (sigma::CoinSpend::BatchVerify(SParams, anonymitySet, spends, setSizes, fPadding))
+        return true;
+
+    // At least one of the proofs is invalid, check them one by one to find out which
+    for (std::size_t i = 0; i < spends.size(); i++) {
+        if (!sigma::CoinSpend::BatchVerify(SParams, anonymitySet, {spends[i]}, {setSizes[i]}, {fPadding[i]})) {
+            LogPrintf("CheckSigmaBlockSpends: verification failed at block=%d, tx=%s, denomID=%d, pubcoinID=%d\n",
+                nHeight, txHashes[i].ToString(), denominationAndId.first, denominationAndId.second);
+        }
+    }
+    return false;
+}
+
+void CSigmaSpendCheck::swap(CSigmaSpendCheck &check) {
+    std::swap(anonymitySet, check.anonymitySet);
+    spends.swap(check.spends);
+    setSizes.swap(check.setSizes);
+    fPadding.swap(check.fPadding);
+    txHashes.swap(check.txHashes);
+    std::swap(denominationAndId, check.denominationAndId);
+    std::swap(nHeight, check.nHeight);
+}
+
+bool CheckSigmaBlockSpends(CValidationState &state, CSigmaTxInfo *sigmaTxInfo, int nHeight) {
+    if (!sigmaTxInfo || sigmaTxInfo->pendingSpends.empty())
+        return true;
+
+    std::vector<CSigmaTxInfo::CPendingSpend> pendingSpends;
+    pendingSpends.swap(sigmaTxInfo->pendingSpends);
+
+    // All the spends of a coin group share its anonymity set and can be verified in one go
+    std::map<pair<sigma::CoinDenomination, int>, std::vector<const CSigmaTxInfo::CPendingSpend *>> spendsByGroup;
+    for (const CSigmaTxInfo::CPendingSpend &pending : pendingSpends)
+        spendsByGroup[std::make_pair(pending.denomination, pending.coinGroupId)].push_back(&pending);
+
+    std::vector<CSigmaSpendCheck> checks;
+    for (const auto &group : spendsByGroup) {
+        const pair<sigma::CoinDenomination, int> &denominationAndId = group.first;
+        const std::vector<const CSigmaTxInfo::CPendingSpend *> &groupSpends = group.second;
+
+        CSigmaState::CoinGroupInfo coinGroup;
+        if (!sigmaState.GetCoinGroupInfo(denominationAndId.first, denominationAndId.second, coinGroup))
+            return state.DoS(100, false, NO_MINT_ZEROCOIN,
+                    "CheckSigmaBlockSpends: Error: no coins were minted with such parameters");
+
+        // Spends may refer to different blocks of the group. Anonymity set of an earlier block is
+        // a prefix of the one of a later block, so the set of the latest referenced block covers them all
+        sigma::AnonymitySetView anonymity_set;
+        std::vector<sigma::AnonymitySetView> spendSets;
+        for (const CSigmaTxInfo::CPendingSpend *pending : groupSpends) {
+            spendSets.push_back(sigmaState.GetAnonymitySet(
+                denominationAndId.first, denominationAndId.second, pending->spend->getAccumulatorBlockHash()));
+            if (spendSets.back().size() > anonymity_set.size())
+                anonymity_set = spendSets.back();
+        }
+
+        checks.emplace_back(anonymity_set, denominationAndId, nHeight);
+        for (std::size_t i = 0; i < groupSpends.size(); i++)
+            checks.back().AddSpend(groupSpends[i]->spend.get(), spendSets[i].size(), groupSpends[i]->fPadding, groupSpends[i]->txHash);
+    }
+
+    // pendingSpends and the sigma state stay unchanged until the checks are done
+    bool fValid = true;
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<CSigmaSpendCheck> control(&sigmaSpendCheckQueue);
+        control.Add(checks);
+        fValid = control.Wait();
+    }
+    else {
+        for (CSigmaSpendCheck &check : checks) {
+            if (!check()) {
+                fValid = false;
+                break;
+            }
+        }
+    }
+
+    if (!fValid)
+        return state.DoS(0, error("CheckSigmaBlockSpends: sigma spend verification failed"));
+    return true;
+}
+
 void DisconnectTipSigma(CBlock & /*block*/, CBlockIndex *pindexDelete) {
-    sigmaState.RemoveBlock(pindexDelete);
+    std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(pindexDelete);
+    sigmaState.RemoveBlock(pindexDelete, *blockData);
+
+    // The mints of the block are no longer in the chain
+    std::vector<uint256> pubCoinValueHashes;
+    for (const auto &pubCoins : blockData->mintedPubCoinsV2) {
+        for (const sigma::PublicCoin &coin : pubCoins.second)
+            pubCoinValueHashes.push_back(GetPubCoinValueHash(coin.getValue()));
+    }
+    if (!pubCoinValueHashes.empty() && !pprivacyindex->EraseMintLocators(pubCoinValueHashes, pindexDelete->GetBlockHash()))
+        LogPrintf("DisconnectTipSigma: failed to erase mint locators of block %s\n", pindexDelete->GetBlockHash().ToString());
 }
 
-Scalar SigmaGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin) {
+Scalar SigmaGetSpendSerialNumber(const CTransaction &tx, unsigned int nIn) {
     if (!tx.IsSigmaSpend())
         return Scalar(uint64_t(0));
 
     try {
-        CDataStream serializedCoinSpend(
-                (const char *)&*(txin.scriptSig.begin() + 1),
-                (const char *)&*txin.scriptSig.end(),
-                SER_NETWORK, PROTOCOL_VERSION);
-        sigma::CoinSpend spend(SParams, serializedCoinSpend);
-        return spend.getCoinSerialNumber();
+        return GetSigmaSpend(tx, nIn)->getCoinSerialNumber();
     }
     catch (const std::ios_base::failure &) {
         return Scalar(uint64_t(0));
     }
+    catch (const CBadTxIn &) {
+        return Scalar(uint64_t(0));
+    }
 }
 
 CAmount GetSpendTransactionInput(const CTransaction &tx) {
@@ -406,37 +676,39 @@ CAmount GetSpendTransactionInput(const CTransaction &tx) {
 
     try {
         CAmount sum(0);
-        for(const CTxIn& txin: tx.vin){
-            CDataStream serializedCoinSpend(
-                    (const char *)&*(txin.scriptSig.begin() + 1),
-                    (const char *)&*txin.scriptSig.end(),
-                    SER_NETWORK, PROTOCOL_VERSION);
-            sigma::CoinSpend spend(SParams, serializedCoinSpend);
-            sum += spend.getIntDenomination();
+        for(unsigned int i = 0; i < tx.vin.size(); i++){
+            sum += GetSigmaSpend(tx, i)->getIntDenomination();
         }
         return sum;
     }
     catch (const std::runtime_error &) {
         return CAmount(0);
     }
+    catch (const CBadTxIn &) {
+        return CAmount(0);
+    }
 }
 
 
 /**
  * Connect a new sigma block to chainActive. pblock is either NULL or a pointer to a CBlock
- * corresponding to pindexNew, to bypass loading it again from disk.
+ * corresponding to pindexNew, to bypass loading it again from disk. privacyData holds the
+ * privacy index data of pindexNew, its sigma part is rebuilt from pblock.
  */
 bool ConnectBlockSigma(
         CValidationState &state,
         const CChainParams &chainparams,
         CBlockIndex *pindexNew,
         const CBlock *pblock,
+        CBlockPrivacyData &privacyData,
         bool fJustCheck) {
     // Add sigma transaction information to index
     if (pblock && pblock->sigmaTxInfo) {
         
-        if (!fJustCheck)
-            pindexNew->spentSerialsV2.clear();
+        if (!fJustCheck) {
+            privacyData.spentSerialsV2.clear();
+            privacyData.mintedPubCoinsV2.clear();
+        }
         
         for(auto& serial: pblock->sigmaTxInfo->spentSerials) {
             if (!CheckSigmaSpendSerial(state, pblock->sigmaTxInfo.get(), serial.first,
@@ -445,7 +717,7 @@ bool ConnectBlockSigma(
             }
             
             if (!fJustCheck) {
-                pindexNew->spentSerialsV2.insert(serial.first);
+                privacyData.spentSerialsV2.insert(serial.first);
                 sigmaState.AddSpend(serial.first);
             }
         }
@@ -455,29 +727,36 @@ bool ConnectBlockSigma(
         if (fJustCheck)
             return true;
         
-        // Update pindexNew.mintedPubCoins
+        // Update mintedPubCoins of the block
         for(const sigma::PublicCoin& mint: pblock->sigmaTxInfo->mints) {
             sigma::CoinDenomination denomination = mint.getDenomination();
             int mintId = sigmaState.AddMint(pindexNew,	mint);
             
             //LogPrintf("ConnectTipSigma: mint added denomination=%d, id=%d\n", denomination, mintId);
             pair<sigma::CoinDenomination, int> denomAndId = make_pair(denomination, mintId);
-            pindexNew->mintedPubCoinsV2[denomAndId].push_back(mint);
+            privacyData.mintedPubCoinsV2[denomAndId].push_back(mint);
         }
+        sigmaState.UpdateTip(pindexNew);
     }
     else if (!fJustCheck) {
-        sigmaState.AddBlock(pindexNew);
+        sigmaState.AddBlock(pindexNew, privacyData);
     }
     return true;
 }
 
 
 bool SigmaBuildStateFromIndex(CChain *chain) {
-    sigmaState.Reset();
-    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
+    // Start from the snapshot of the last flush if there is one, only the blocks after it are replayed
+    CBlockIndex *snapshotBlock = sigmaState.ReadSnapshot(chain);
+    if (snapshotBlock)
+        LogPrintf("Loaded Sigma state snapshot at height %d\n", snapshotBlock->nHeight);
+    for (CBlockIndex *blockIndex = snapshotBlock ? chain->Next(snapshotBlock) : chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
     {
-        sigmaState.AddBlock(blockIndex);
+        sigmaState.AddBlock(blockIndex, *pprivacyindex->ReadBlockData(blockIndex));
     }
+    // Groups no mint can go to anymore are kept in their group files rather than in memory
+    sigmaState.SealGroups();
+
     // DEBUG
     LogPrintf(
         "Latest IDs for sigma coin groups are %d, %d, %d, %d, %d\n",
@@ -508,7 +787,7 @@ void CSigmaTxInfo::Complete() {
 
 // CSigmaState
 
-CSigmaState::CSigmaState() {
+CSigmaState::CSigmaState() : tip(NULL), fTipKnown(true), fSnapshotStale(true) {
 }
 
 int CSigmaState::AddMint(
@@ -546,18 +825,45 @@ int CSigmaState::AddMint(
     coinInfo.denomination = denomination;
     coinInfo.id = mintCoinGroupId;
     coinInfo.nHeight = index->nHeight;
-    mintedPubCoins.insert(std::make_pair(pubCoin, coinInfo));
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_coins);
+        InsertMintedCoin(pubCoin, coinInfo);
+    }
+
+    // Coins of a block are stored in reverse, the new one goes in front of the ones already added
+    CoinGroupCoins &groupCoins = coinGroupCoins[make_pair(denomination, mintCoinGroupId)];
+    std::vector<GroupElement> &values = groupCoins.MutableValues();
+    if (groupCoins.blocks.empty() || groupCoins.blocks.back().first != index)
+        groupCoins.blocks.push_back(std::make_pair(index, values.size()));
+    std::size_t blockStart = groupCoins.blocks.size() > 1 ? groupCoins.blocks[groupCoins.blocks.size() - 2].second : 0;
+    values.insert(values.begin() + blockStart, pubCoin.getValue());
+    groupCoins.blocks.back().second++;
+    changedGroups.insert(make_pair(denomination, mintCoinGroupId));
     return mintCoinGroupId;
 }
 
 void CSigmaState::AddSpend(const Scalar &serial) {
-    usedCoinSerials.insert(serial);
+    boost::unique_lock<boost::shared_mutex> lock(cs_coins);
+    InsertUsedCoinSerial(serial);
 }
 
-void CSigmaState::AddBlock(CBlockIndex *index) {
+void CSigmaState::InsertMintedCoin(const sigma::PublicCoin &pubCoin, const CMintedCoinInfo &coinInfo) {
+    if (mintedPubCoins.insert(std::make_pair(pubCoin, coinInfo)).second)
+        mintedPubCoinHashes.emplace(GetPubCoinValueHash(pubCoin.getValue()), pubCoin.getValue());
+}
+
+void CSigmaState::InsertUsedCoinSerial(const Scalar &serial) {
+    if (usedCoinSerials.insert(serial).second) {
+        usedCoinSerialHashes.emplace(GetSerialHash(serial), serial);
+        changedSerials[serial] = true;
+    }
+}
+
+void CSigmaState::AddBlock(CBlockIndex *index, const CBlockPrivacyData &blockData) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_coins);
     for(
         const PAIRTYPE(PAIRTYPE(sigma::CoinDenomination, int), vector<sigma::PublicCoin>) &pubCoins:
-            index->mintedPubCoinsV2) {
+            blockData.mintedPubCoinsV2) {
         if (!pubCoins.second.empty()) {
             CoinGroupInfo& coinGroup = coinGroups[pubCoins.first];
 
@@ -565,6 +871,15 @@ void CSigmaState::AddBlock(CBlockIndex *index) {
                 coinGroup.firstBlock = index;
             coinGroup.lastBlock = index;
             coinGroup.nCoins += pubCoins.second.size();
+
+            CoinGroupCoins& groupCoins = coinGroupCoins[pubCoins.first];
+            std::vector<GroupElement> &values = groupCoins.MutableValues();
+            values.insert(values.end(), pubCoins.second.size(), GroupElement());
+            std::transform(pubCoins.second.rbegin(), pubCoins.second.rend(),
+                values.end() - pubCoins.second.size(),
+                [](const sigma::PublicCoin &coin) { return coin.getValue(); });
+            groupCoins.blocks.push_back(std::make_pair(index, values.size()));
+            changedGroups.insert(pubCoins.first);
         }
 
         latestCoinIds[pubCoins.first.first] = pubCoins.first.second;
@@ -573,26 +888,50 @@ void CSigmaState::AddBlock(CBlockIndex *index) {
             coinInfo.denomination = pubCoins.first.first;
             coinInfo.id = pubCoins.first.second;
             coinInfo.nHeight = index->nHeight;
-            mintedPubCoins.insert(pair<sigma::PublicCoin, CMintedCoinInfo>(coin, coinInfo));
+            InsertMintedCoin(coin, coinInfo);
         }
     }
 
-    for(const Scalar &serial: index->spentSerialsV2) {
-        usedCoinSerials.insert(serial);
+    for(const Scalar &serial: blockData.spentSerialsV2) {
+        InsertUsedCoinSerial(serial);
     }
+
+    UpdateTip(index);
+}
+
+void CSigmaState::UpdateTip(CBlockIndex *index) {
+    // An empty state is the one of the genesis block, it has no sigma data
+    if (tip == index)
+        return;
+    if (fTipKnown && (index->pprev == tip || (tip == NULL && index->pprev && index->pprev->pprev == NULL)))
+        tip = index;
+    else
+        fTipKnown = false;
 }
 
-void CSigmaState::RemoveBlock(CBlockIndex *index) {
+void CSigmaState::RemoveBlock(CBlockIndex *index, const CBlockPrivacyData &blockData) {
     // roll back accumulator updates
     for(
         const PAIRTYPE(PAIRTYPE(sigma::CoinDenomination, int),vector<sigma::PublicCoin>) &coin:
-        index->mintedPubCoinsV2)
+        blockData.mintedPubCoinsV2)
     {
         CoinGroupInfo   &coinGroup = coinGroups[coin.first];
         int  nMintsToForget = coin.second.size();
 
         assert(coinGroup.nCoins >= nMintsToForget);
 
+        if (nMintsToForget > 0) {
+            changedGroups.insert(coin.first);
+            CoinGroupCoins &groupCoins = coinGroupCoins[coin.first];
+            assert(!groupCoins.blocks.empty() && groupCoins.blocks.back().first == index);
+            groupCoins.blocks.pop_back();
+            if (groupCoins.blocks.empty())
+                coinGroupCoins.erase(coin.first);
+            else {
+                groupCoins.MutableValues().resize(groupCoins.blocks.back().second);
+            }
+        }
+
         if ((coinGroup.nCoins -= nMintsToForget) == 0) {
             // all the coins of this group have been erased, remove the group altogether
             coinGroups.erase(coin.first);
@@ -600,17 +939,18 @@ void CSigmaState::RemoveBlock(CBlockIndex *index) {
             latestCoinIds[coin.first.first]--;
         }
         else {
-            // roll back lastBlock to previous position
-            do {
-                assert(coinGroup.lastBlock != coinGroup.firstBlock);
-                coinGroup.lastBlock = coinGroup.lastBlock->pprev;
-            } while (coinGroup.lastBlock->mintedPubCoinsV2.count(coin.first) == 0);
+            // roll back lastBlock to the previous block with coins of the group
+            const CoinGroupCoins &groupCoins = coinGroupCoins[coin.first];
+            assert(!groupCoins.blocks.empty() && groupCoins.blocks.back().first != index);
+            coinGroup.lastBlock = groupCoins.blocks.back().first;
         }
     }
 
+    boost::unique_lock<boost::shared_mutex> lock(cs_coins);
+
     // roll back mints
     for(const PAIRTYPE(PAIRTYPE(sigma::CoinDenomination, int),vector<sigma::PublicCoin>) &pubCoins:
-                  index->mintedPubCoinsV2) {
+                  blockData.mintedPubCoinsV2) {
         for(const sigma::PublicCoin &coin: pubCoins.second) {
             auto coins = mintedPubCoins.equal_range(coin);
             auto coinIt = find_if(
@@ -621,14 +961,24 @@ void CSigmaState::RemoveBlock(CBlockIndex *index) {
                 });
             assert(coinIt != coins.second);
             mintedPubCoins.erase(coinIt);
+
+            auto hashIt = mintedPubCoinHashes.find(GetPubCoinValueHash(coin.getValue()));
+            assert(hashIt != mintedPubCoinHashes.end());
+            mintedPubCoinHashes.erase(hashIt);
         }
     }
-    index->mintedPubCoinsV2.clear();
     // roll back spends
-    for(const Scalar &serial: index->spentSerialsV2) {
-        usedCoinSerials.erase(serial);
+    for(const Scalar &serial: blockData.spentSerialsV2) {
+        if (usedCoinSerials.erase(serial) > 0) {
+            usedCoinSerialHashes.erase(GetSerialHash(serial));
+            changedSerials[serial] = false;
+        }
     }
-    index->spentSerialsV2.clear();
+
+    if (fTipKnown && tip == index)
+        tip = index->pprev;
+    else
+        fTipKnown = false;
 }
 
 bool CSigmaState::GetCoinGroupInfo(
@@ -637,6 +987,7 @@ bool CSigmaState::GetCoinGroupInfo(
         CoinGroupInfo& result) {
     std::pair<sigma::CoinDenomination, int> key =
         std::make_pair(denomination, group_id);
+    LOCK(cs_main);
     if (coinGroups.count(key) == 0)
         return false;
 
@@ -645,10 +996,12 @@ bool CSigmaState::GetCoinGroupInfo(
 }
 
 bool CSigmaState::IsUsedCoinSerial(const Scalar &coinSerial) {
+    boost::shared_lock<boost::shared_mutex> lock(cs_coins);
     return usedCoinSerials.count(coinSerial) != 0;
 }
 
 bool CSigmaState::HasCoin(const sigma::PublicCoin& pubCoin) {
+    boost::shared_lock<boost::shared_mutex> lock(cs_coins);
     return mintedPubCoins.find(pubCoin) != mintedPubCoins.end();
 }
 
@@ -658,41 +1011,74 @@ int CSigmaState::GetCoinSetForSpend(
         sigma::CoinDenomination denomination,
         int coinGroupID,
         uint256& blockHash_out,
-        std::vector<sigma::PublicCoin>& coins_out) {
+        sigma::AnonymitySetView& coins_out) {
 
     pair<sigma::CoinDenomination, int> denomAndId = std::make_pair(denomination, coinGroupID);
 
-    if (coinGroups.count(denomAndId) == 0)
+    LOCK(cs_main);
+    auto groupCoins = coinGroupCoins.find(denomAndId);
+    if (groupCoins == coinGroupCoins.end())
         return 0;
 
-    CoinGroupInfo coinGroup = coinGroups[denomAndId];
-
-    int numberOfCoins = 0;
-    for (CBlockIndex *block = coinGroup.lastBlock;
-            ;
-            block = block->pprev) {
-        if (block->mintedPubCoinsV2[denomAndId].size() > 0) {
-            if (block->nHeight <= maxHeight) {
-                if (numberOfCoins == 0) {
-                    // latest block satisfying given conditions
-                    // remember block hash
-                    blockHash_out = block->GetBlockHash();
-                }
-                numberOfCoins += block->mintedPubCoinsV2[denomAndId].size();
-                coins_out.insert(coins_out.end(),
-                        block->mintedPubCoinsV2[denomAndId].begin(),
-                        block->mintedPubCoinsV2[denomAndId].end());
+    // latest block satisfying given conditions
+    const std::vector<std::pair<CBlockIndex *, std::size_t>> &blocks = groupCoins->second.blocks;
+    auto block = std::upper_bound(blocks.begin(), blocks.end(), maxHeight,
+        [](int height, const std::pair<CBlockIndex *, std::size_t> &block) {
+            return height < block.first->nHeight;
+        });
+    if (block == blocks.begin())
+        return 0;
+    --block;
+
+    blockHash_out = block->first->GetBlockHash();
+    coins_out = groupCoins->second.View(block->second);
+    return block->second;
+}
+
+sigma::AnonymitySetView CSigmaState::GetAnonymitySet(
+        sigma::CoinDenomination denomination,
+        int coinGroupID,
+        const uint256& blockHash,
+        CBlockIndex **setBlock_out) {
+
+    // Blocks are connected under cs_main, the view taken under it keeps its coins when they change
+    LOCK(cs_main);
+    auto groupCoins = coinGroupCoins.find(std::make_pair(denomination, coinGroupID));
+    if (groupCoins == coinGroupCoins.end()) {
+        if (setBlock_out)
+            *setBlock_out = NULL;
+        return sigma::AnonymitySetView();
+    }
+
+    // Spends usually refer to one of the latest blocks with coins of the group, look for it from the end
+    const std::vector<std::pair<CBlockIndex *, std::size_t>> &blocks = groupCoins->second.blocks;
+    std::size_t i = blocks.size();
+    while (i > 0 && blocks[i - 1].first->GetBlockHash() != blockHash)
+        --i;
+
+    if (i == 0) {
+        // The block may still be one between the first and the last block of the group without coins of
+        // it, its set is the one of the latest block with coins before it
+        i = 1;
+        for (CBlockIndex *index = blocks.back().first; index != blocks.front().first; index = index->pprev) {
+            if (index->GetBlockHash() == blockHash) {
+                i = std::upper_bound(blocks.begin(), blocks.end(), index->nHeight,
+                    [](int height, const std::pair<CBlockIndex *, std::size_t> &block) {
+                        return height < block.first->nHeight;
+                    }) - blocks.begin();
+                break;
             }
         }
-        if (block == coinGroup.firstBlock) {
-            break ;
-        }
     }
-    return numberOfCoins;
+
+    if (setBlock_out)
+        *setBlock_out = blocks[i - 1].first;
+    return groupCoins->second.View(blocks[i - 1].second);
 }
 
 std::pair<int, int> CSigmaState::GetMintedCoinHeightAndId(
         const sigma::PublicCoin& pubCoin) {
+    boost::shared_lock<boost::shared_mutex> lock(cs_coins);
     auto coinIt = mintedPubCoins.find(pubCoin);
 
     if (coinIt != mintedPubCoins.end()) {
@@ -702,6 +1088,7 @@ std::pair<int, int> CSigmaState::GetMintedCoinHeightAndId(
 }
 
 bool CSigmaState::AddSpendToMempool(const vector<Scalar> &coinSerials, uint256 txHash) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     for(Scalar coinSerial: coinSerials){
         if (IsUsedCoinSerial(coinSerial) || mempoolCoinSerials.count(coinSerial))
             return false;
@@ -713,6 +1100,7 @@ bool CSigmaState::AddSpendToMempool(const vector<Scalar> &coinSerials, uint256 t
 }
 
 bool CSigmaState::AddSpendToMempool(const Scalar &coinSerial, uint256 txHash) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     if (IsUsedCoinSerial(coinSerial) || mempoolCoinSerials.count(coinSerial))
         return false;
 
@@ -721,21 +1109,26 @@ bool CSigmaState::AddSpendToMempool(const Scalar &coinSerial, uint256 txHash) {
 }
 
 void CSigmaState::RemoveSpendFromMempool(const Scalar& coinSerial) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     mempoolCoinSerials.erase(coinSerial);
 }
 
 uint256 CSigmaState::GetMempoolConflictingTxHash(const Scalar& coinSerial) {
-    if (mempoolCoinSerials.count(coinSerial) == 0)
+    boost::shared_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
+    auto it = mempoolCoinSerials.find(coinSerial);
+    if (it == mempoolCoinSerials.end())
         return uint256();
 
-    return mempoolCoinSerials[coinSerial];
+    return it->second;
 }
 
 bool CSigmaState::CanAddSpendToMempool(const Scalar& coinSerial) {
+    boost::shared_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     return !IsUsedCoinSerial(coinSerial) && mempoolCoinSerials.count(coinSerial) == 0;
 }
 
 bool CSigmaState::AddMintToMempool(const sigma::PublicCoin &coinMint, uint256 txHash) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     if (HasCoin(coinMint) || mempoolCoinMints.count(coinMint))
         return false;
 
@@ -744,27 +1137,248 @@ bool CSigmaState::AddMintToMempool(const sigma::PublicCoin &coinMint, uint256 tx
 }
 
 void CSigmaState::RemoveMintFromMempool(const sigma::PublicCoin &coinMint) {
+    boost::unique_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     mempoolCoinMints.erase(coinMint);
 }
 
 uint256 CSigmaState::GetMempoolMintConflictingTxHash(const sigma::PublicCoin &coinMint) {
-    if (mempoolCoinMints.count(coinMint) == 0)
+    boost::shared_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
+    auto it = mempoolCoinMints.find(coinMint);
+    if (it == mempoolCoinMints.end())
         return uint256();
 
-    return mempoolCoinMints[coinMint];
+    return it->second;
 }
 
 bool CSigmaState::CanAddMintToMempool(const sigma::PublicCoin &coinMint) {
+    boost::shared_lock<boost::shared_mutex> lock(cs_mempoolConflicts);
     return !HasCoin(coinMint) && mempoolCoinMints.count(coinMint) == 0;
 }
 
 
 void CSigmaState::Reset() {
+    boost::unique_lock<boost::shared_mutex> lockMempool(cs_mempoolConflicts);
+    boost::unique_lock<boost::shared_mutex> lockCoins(cs_coins);
     coinGroups.clear();
+    coinGroupCoins.clear();
     usedCoinSerials.clear();
+    usedCoinSerialHashes.clear();
     latestCoinIds.clear();
     mintedPubCoins.clear();
+    mintedPubCoinHashes.clear();
     mempoolCoinSerials.clear();
+    tip = NULL;
+    fTipKnown = true;
+    changedSerials.clear();
+    changedGroups.clear();
+    fSnapshotStale = true;
+}
+
+void CSigmaState::SealGroups() {
+    for (auto &group : coinGroupCoins) {
+        CoinGroupCoins &groupCoins = group.second;
+        // Mints only go to the latest group of a denomination
+        if (groupCoins.sealedValues || group.first.second >= GetLatestCoinID(group.first.first))
+            continue;
+
+        // Views of the group keep the array or the file they were taken from
+        groupCoins.sealedValues = CSigmaGroupFile::Create(
+            GetSigmaGroupFilePath((int)group.first.first, group.first.second), groupCoins.data(), groupCoins.size());
+        if (groupCoins.sealedValues) {
+            groupCoins.values.reset();
+            changedGroups.insert(group.first);
+        }
+        else
+            LogPrintf("%s: failed to seal coin group %d of denomination %d, keeping it in memory\n",
+                __func__, group.first.second, (int)group.first.first);
+    }
+}
+
+std::shared_ptr<const CSigmaGroupFile> CSigmaState::GetSealedGroup(sigma::CoinDenomination denomination, int id) const {
+    auto groupCoins = coinGroupCoins.find(std::make_pair(denomination, id));
+    if (groupCoins == coinGroupCoins.end())
+        return nullptr;
+    return groupCoins->second.sealedValues;
+}
+
+bool CSigmaState::WriteSnapshot(const CBlockIndex *chainTip) {
+    SealGroups();
+
+    if (!fTipKnown) {
+        // Blocks were added out of chain order, the state is rebuilt before it can be written again
+        changedSerials.clear();
+        changedGroups.clear();
+        fSnapshotStale = true;
+        return true;
+    }
+    if (tip == NULL || tip != chainTip)
+        return true;
+
+    std::vector<std::pair<Scalar, bool>> serials;
+    std::set<std::pair<sigma::CoinDenomination, int>> groupIds;
+    if (fSnapshotStale) {
+        serials.reserve(usedCoinSerials.size());
+        for (const Scalar &serial : usedCoinSerials)
+            serials.push_back(std::make_pair(serial, true));
+        for (const auto &group : coinGroupCoins)
+            groupIds.insert(group.first);
+    }
+    else {
+        serials.assign(changedSerials.begin(), changedSerials.end());
+        groupIds = changedGroups;
+    }
+
+    // Sealed groups are stored as the checksums of their group files, blocks of coin groups as heights in
+    // the active chain. A group that is gone is written empty
+    std::vector<std::pair<std::pair<int, int>, std::vector<unsigned char>>> groups;
+    for (const std::pair<sigma::CoinDenomination, int> &denomAndId : groupIds) {
+        std::vector<unsigned char> data;
+        auto group = coinGroupCoins.find(denomAndId);
+        if (group != coinGroupCoins.end()) {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            bool fSealed = (bool)group->second.sealedValues;
+            ss << fSealed;
+            if (fSealed)
+                ss << group->second.sealedValues->GetChecksum();
+            else
+                ss << *group->second.values;
+            WriteCompactSize(ss, group->second.blocks.size());
+            for (const std::pair<CBlockIndex *, std::size_t> &block : group->second.blocks)
+                ss << block.first->nHeight << (uint64_t)block.second;
+            data.assign(ss.begin(), ss.end());
+        }
+        groups.push_back(std::make_pair(std::make_pair((int)denomAndId.first, denomAndId.second), std::move(data)));
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << SIGMA_STATE_SNAPSHOT_VERSION << tip->GetBlockHash() << tip->nHeight;
+    ss << std::vector<std::pair<sigma::CoinDenomination, int>>(latestCoinIds.begin(), latestCoinIds.end());
+    WriteCompactSize(ss, coinGroupCoins.size());
+    for (const auto &group : coinGroupCoins)
+        ss << group.first;
+
+    if (!pprivacyindex->WriteSigmaStateSnapshot(std::vector<unsigned char>(ss.begin(), ss.end()), serials, groups, fSnapshotStale))
+        return false;
+
+    changedSerials.clear();
+    changedGroups.clear();
+    fSnapshotStale = false;
+    return true;
+}
+
+CBlockIndex *CSigmaState::ReadSnapshot(CChain *chain) {
+    Reset();
+
+    std::vector<unsigned char> snapshot;
+    std::vector<Scalar> serials;
+    if (!pprivacyindex->ReadSigmaStateSnapshot(snapshot, serials))
+        return NULL;
+
+    try {
+        CDataStream ss(snapshot, SER_DISK, CLIENT_VERSION);
+        int nVersion;
+        ss >> nVersion;
+        if (nVersion != SIGMA_STATE_SNAPSHOT_VERSION)
+            throw std::runtime_error("unknown version");
+
+        uint256 snapshotHash;
+        int nSnapshotHeight;
+        ss >> snapshotHash >> nSnapshotHeight;
+        CBlockIndex *snapshotBlock = (*chain)[nSnapshotHeight];
+        if (snapshotBlock == NULL || snapshotBlock->GetBlockHash() != snapshotHash)
+            throw std::runtime_error("block is not in the active chain");
+
+        std::vector<std::pair<sigma::CoinDenomination, int>> latestIds;
+        ss >> latestIds;
+        latestCoinIds.insert(latestIds.begin(), latestIds.end());
+
+        // Blocks of all groups as (height, group, first coin, end of coins), to add the minted coins in
+        // the order AddBlock() does
+        std::vector<std::tuple<int, std::pair<sigma::CoinDenomination, int>, std::size_t, std::size_t>> mintBlocks;
+        uint64_t nGroups = ReadCompactSize(ss);
+        for (uint64_t i = 0; i < nGroups; i++) {
+            std::pair<sigma::CoinDenomination, int> denomAndId;
+            ss >> denomAndId;
+            if (coinGroupCoins.count(denomAndId))
+                throw std::runtime_error("duplicate coin group");
+
+            std::vector<unsigned char> data;
+            if (!pprivacyindex->ReadSigmaCoinGroup(std::make_pair((int)denomAndId.first, denomAndId.second), data))
+                throw std::runtime_error("missing coin group");
+            CDataStream gs(data, SER_DISK, CLIENT_VERSION);
+
+            CoinGroupCoins &groupCoins = coinGroupCoins[denomAndId];
+            bool fSealed;
+            gs >> fSealed;
+            if (fSealed) {
+                uint256 checksum;
+                gs >> checksum;
+                groupCoins.sealedValues = CSigmaGroupFile::Open(
+                    GetSigmaGroupFilePath((int)denomAndId.first, denomAndId.second), checksum);
+                if (!groupCoins.sealedValues)
+                    throw std::runtime_error("missing group file");
+            }
+            else {
+                groupCoins.values = std::make_shared<std::vector<GroupElement>>();
+                gs >> *groupCoins.values;
+            }
+            uint64_t nBlocks = ReadCompactSize(gs);
+            if (nBlocks == 0)
+                throw std::runtime_error("empty coin group");
+
+            int nPrevHeight = -1;
+            std::size_t nBegin = 0;
+            for (uint64_t j = 0; j < nBlocks; j++) {
+                int nHeight;
+                uint64_t nEnd;
+                gs >> nHeight >> nEnd;
+                if (nHeight <= nPrevHeight || nHeight > nSnapshotHeight || nEnd <= nBegin || nEnd > groupCoins.size())
+                    throw std::runtime_error("inconsistent coin group");
+                groupCoins.blocks.push_back(std::make_pair((*chain)[nHeight], (std::size_t)nEnd));
+                mintBlocks.push_back(std::make_tuple(nHeight, denomAndId, nBegin, (std::size_t)nEnd));
+                nPrevHeight = nHeight;
+                nBegin = nEnd;
+            }
+            if (nBegin != groupCoins.size())
+                throw std::runtime_error("inconsistent coin group");
+
+            CoinGroupInfo &coinGroup = coinGroups[denomAndId];
+            coinGroup.firstBlock = groupCoins.blocks.front().first;
+            coinGroup.lastBlock = groupCoins.blocks.back().first;
+            coinGroup.nCoins = groupCoins.size();
+        }
+
+        std::sort(mintBlocks.begin(), mintBlocks.end());
+        boost::unique_lock<boost::shared_mutex> lock(cs_coins);
+        for (const auto &block : mintBlocks) {
+            const std::pair<sigma::CoinDenomination, int> &denomAndId = std::get<1>(block);
+            const GroupElement *values = coinGroupCoins[denomAndId].data();
+            for (std::size_t k = std::get<2>(block); k < std::get<3>(block); k++) {
+                CMintedCoinInfo coinInfo;
+                coinInfo.denomination = denomAndId.first;
+                coinInfo.id = denomAndId.second;
+                coinInfo.nHeight = std::get<0>(block);
+                InsertMintedCoin(sigma::PublicCoin(values[k], denomAndId.first), coinInfo);
+            }
+        }
+
+        for (const Scalar &serial : serials)
+            InsertUsedCoinSerial(serial);
+        lock.unlock();
+
+        // The records in the privacy index are the state now
+        changedSerials.clear();
+        changedGroups.clear();
+        fSnapshotStale = false;
+
+        tip = snapshotBlock;
+        return snapshotBlock;
+    }
+    catch (const std::exception &e) {
+        LogPrintf("%s: ignoring the Sigma state snapshot: %s\n", __func__, e.what());
+        Reset();
+        return NULL;
+    }
 }
 
 CSigmaState* CSigmaState::GetSigmaState() {
@@ -781,28 +1395,32 @@ int CSigmaState::GetLatestCoinID(sigma::CoinDenomination denomination) const {
 }
 
 bool CSigmaState::HasCoinHash(GroupElement &pubCoinValue, const uint256 &pubCoinValueHash) {
-    for ( auto it = mintedPubCoins.begin(); it != mintedPubCoins.end(); ++it ){
-        sigma::PublicCoin pubCoin = (*it).first;
-        if(GetPubCoinValueHash(pubCoin.getValue())==pubCoinValueHash){
-            pubCoinValue = pubCoin.getValue();
-            return true;
-        }
-    }
-    return false;
+    boost::shared_lock<boost::shared_mutex> lock(cs_coins);
+    auto it = mintedPubCoinHashes.find(pubCoinValueHash);
+    if (it == mintedPubCoinHashes.end())
+        return false;
+    pubCoinValue = it->second;
+    return true;
 }
 
 bool CSigmaState::IsUsedCoinSerialHash(Scalar &coinSerial, const uint256 &coinSerialHash) {
-    for ( auto it = usedCoinSerials.begin(); it != usedCoinSerials.end(); ++it ){
-        if(GetSerialHash(*it)==coinSerialHash){
-            coinSerial = *it;
-            return true;
-        }
-    }
-    return false;
+    boost::shared_lock<boost::shared_mutex> lock(cs_coins);
+    auto it = usedCoinSerialHashes.find(coinSerialHash);
+    if (it == usedCoinSerialHashes.end())
+        return false;
+    coinSerial = it->second;
+    return true;
 }
 
 
 bool SigmaGetMintTxHash(uint256& txHash, GroupElement pubCoinValue) {
+    CSigmaMintLocator locator;
+    if (pprivacyindex->ReadMintLocator(GetPubCoinValueHash(pubCoinValue), locator)) {
+        txHash = locator.txHash;
+        return true;
+    }
+
+    // Blocks connected before the privacy index kept mint locators have to be read
     int mintHeight = 0;
     int coinId = 0;
 
@@ -856,6 +1474,12 @@ bool SigmaGetMintTxHash(uint256& txHash, GroupElement pubCoinValue) {
 }
 
 bool SigmaGetMintTxHash(uint256& txHash, uint256 pubCoinValueHash) {
+    CSigmaMintLocator locator;
+    if (pprivacyindex->ReadMintLocator(pubCoinValueHash, locator)) {
+        txHash = locator.txHash;
+        return true;
+    }
+
     GroupElement pubCoinValue;
     if(!sigmaState.HasCoinHash(pubCoinValue, pubCoinValueHash)){
         return false;
@@ -14,11 +14,16 @@
 #include <libzerocoin/Zerocoin.h>
 #include <sigma/coin.h>
 #include <sigma/coinspend.h>
+#include <zerocoin/sigmagroupfile.h>
 #include <unordered_set>
 #include <unordered_map>
+#include <atomic>
+#include <set>
 #include <functional>
 #include <net.h>
 
+#include <boost/thread/shared_mutex.hpp>
+
 #define COINS_PER_ID 15000
 
 // sigma parameters
@@ -60,9 +65,24 @@ public:
     // Vector of <pubCoin> for all the mints.
     std::vector<sigma::PublicCoin> mints;
 
+    // Value and transaction hash of every mint, in the order of the block
+    std::vector<std::pair<GroupElement, uint256>> mintTxHashes;
+
     // serial for every spend (map from serial to denomination)
     std::unordered_map<Scalar, int, sigma::CScalarHash> spentSerials;
 
+    // Spend whose sigma proof is left to CheckSigmaBlockSpends(). Everything else about it is already checked
+    struct CPendingSpend {
+        std::shared_ptr<const sigma::CoinSpend> spend;
+        sigma::CoinDenomination denomination;
+        int coinGroupId;
+        bool fPadding;
+        uint256 txHash;
+    };
+
+    // spends of the block waiting for batch verification
+    std::vector<CPendingSpend> pendingSpends;
+
     // information about transactions in the block is complete
     bool fInfoIsComplete;
 
@@ -75,6 +95,11 @@ public:
 secp_primitives::GroupElement ParseSigmaMintScript(const CScript& script);
 std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> ParseSigmaSpend(const CTxIn& in);
 
+// Spend of input nIn of tx. Parsed spends are kept in a cache shared by all the checks a transaction goes
+// through, so the proof of an input is deserialized once. Throws like ParseSigmaSpend() but doesn't check
+// the coin group id
+std::shared_ptr<const sigma::CoinSpend> GetSigmaSpend(const CTransaction& tx, unsigned int nIn);
+
 bool CheckSigmaTransaction(
   const CTransaction &tx,
     CValidationState &state,
@@ -84,6 +109,51 @@ bool CheckSigmaTransaction(
   bool isCheckWallet,
   CSigmaTxInfo *sigmaTxInfo);
 
+// Memory used by the cache of verified sigma proofs, enough for over 100000 spends
+static const size_t SIGMA_PROOF_CACHE_SIZE = 4 << 20;
+
+// Number of parsed spends kept by GetSigmaSpend(), a few MiB
+static const size_t SIGMA_SPEND_CACHE_ENTRIES = 2000;
+
+// To be called once in AppInitMain/BasicTestingSetup to initialize the sigma proof cache
+void InitSigmaProofCache();
+
+// Verify sigma proofs of all the spends collected in sigmaTxInfo->pendingSpends, one batch per coin group.
+// The batches go to the sigma spend check queue, so the coin groups of a block are verified in parallel
+bool CheckSigmaBlockSpends(CValidationState &state, CSigmaTxInfo *sigmaTxInfo, int nHeight);
+
+// Batch verification of the sigma proofs of the spends of one coin group in a block, a work item of the
+// sigma spend check queue. The spends are borrowed and must outlive it, the view keeps the anonymity set alive
+class CSigmaSpendCheck
+{
+private:
+    sigma::AnonymitySetView anonymitySet;
+    std::vector<const sigma::CoinSpend *> spends;
+    std::vector<std::size_t> setSizes;
+    std::vector<bool> fPadding;
+
+    // Where the spends come from, to log the ones that fail
+    std::vector<uint256> txHashes;
+    std::pair<sigma::CoinDenomination, int> denominationAndId;
+    int nHeight;
+
+public:
+    CSigmaSpendCheck(): nHeight(0) {}
+    CSigmaSpendCheck(const sigma::AnonymitySetView &anonymitySetIn, std::pair<sigma::CoinDenomination, int> denominationAndIdIn,
+            int nHeightIn) :
+        anonymitySet(anonymitySetIn), denominationAndId(denominationAndIdIn), nHeight(nHeightIn) {}
+
+    // Spend over the anonymitySet.prefix(setSize)
+    void AddSpend(const sigma::CoinSpend *spend, std::size_t setSize, bool fPaddingIn, const uint256 &txHash);
+
+    bool operator()();
+
+    void swap(CSigmaSpendCheck &check);
+};
+
+// Worker of the sigma spend check queue, started as many times as ThreadScriptCheck()
+void ThreadSigmaSpendCheck();
+
 void DisconnectTipSigma(CBlock &block, CBlockIndex *pindexDelete);
 
 bool ConnectBlockSigma(
@@ -91,14 +161,19 @@ bool ConnectBlockSigma(
   const CChainParams& chainparams,
   CBlockIndex* pindexNew,
   const CBlock *pblock,
+  CBlockPrivacyData& privacyData,
   bool fJustCheck=false);
 
 bool SigmaBuildStateFromIndex(CChain *chain);
 
-Scalar SigmaGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin);
+Scalar SigmaGetSpendSerialNumber(const CTransaction &tx, unsigned int nIn);
 CAmount GetSpendTransactionInput(const CTransaction &tx);
 /*
  * State of minted/spent coins as extracted from the index
+ *
+ * Blocks are added and removed under cs_main. The lookups of minted coins and used serials and the mempool
+ * conflict tracking have locks of their own, so that they can be used without holding cs_main. Everything
+ * else still needs cs_main.
  */
 class CSigmaState {
 friend bool SigmaBuildStateFromIndex(CChain *, set<CBlockIndex *> &);
@@ -114,6 +189,52 @@ public:
         int nCoins;
     };
 
+    // Coins of a coin group in one array, anonymity sets are views into it
+    struct CoinGroupCoins {
+        // Coin values, newest last. Blocks are in chain order and the coins of every block are reversed,
+        // so that the anonymity set ending at any block of the group is a prefix of the array, see
+        // sigma::AnonymitySetView. Views share the array, it is copied before it changes while one is alive
+        std::shared_ptr<std::vector<GroupElement>> values;
+
+        // The same array mapped from the group file once the group is sealed, values is NULL then
+        std::shared_ptr<const CSigmaGroupFile> sealedValues;
+
+        const GroupElement *data() const {
+            return sealedValues ? sealedValues->data() : values ? values->data() : NULL;
+        }
+        std::size_t size() const { return sealedValues ? sealedValues->size() : values ? values->size() : 0; }
+
+        // Anonymity set of the oldest nCoins coins, the coins stay valid for as long as the view exists
+        sigma::AnonymitySetView View(std::size_t nCoins) const {
+            if (sealedValues)
+                return sigma::AnonymitySetView(sealedValues->data(), nCoins, sealedValues);
+            return sigma::AnonymitySetView(data(), nCoins, values);
+        }
+
+        // The array to change. A sealed group is brought back to memory, a reorganization may reopen it, and
+        // an array a view still uses is copied. Views are only taken under cs_main, which the caller holds
+        std::vector<GroupElement> &MutableValues() {
+            if (sealedValues) {
+                values = std::make_shared<std::vector<GroupElement>>(sealedValues->data(), sealedValues->data() + sealedValues->size());
+                sealedValues.reset();
+            }
+            else if (!values) {
+                values = std::make_shared<std::vector<GroupElement>>();
+            }
+            else if (values.use_count() > 1) {
+                values = std::make_shared<std::vector<GroupElement>>(*values);
+            }
+            else {
+                // The last view may just have been dropped by another thread, its reads come before our writes
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *values;
+        }
+
+        // Blocks of the group with the number of its coins minted in the block and before it
+        std::vector<std::pair<CBlockIndex *, std::size_t>> blocks;
+    };
+
     struct CMintedCoinInfo {
         sigma::CoinDenomination denomination;
 
@@ -142,12 +263,15 @@ public:
     void AddSpend(const Scalar& serial);
 
     // Add everything from the block to the state
-    void AddBlock(CBlockIndex *index);
+    void AddBlock(CBlockIndex *index, const CBlockPrivacyData &blockData);
 
     // Disconnect block from the chain rolling back mints and spends
-    void RemoveBlock(CBlockIndex *index);
+    void RemoveBlock(CBlockIndex *index, const CBlockPrivacyData &blockData);
+
+    // Record that everything from the block was added to the state
+    void UpdateTip(CBlockIndex *index);
 
-    // Query coin group with given denomination and id
+    // Query coin group with given denomination and id. Takes cs_main
     bool GetCoinGroupInfo(sigma::CoinDenomination denomination,
         int group_id, CoinGroupInfo &result);
 
@@ -162,13 +286,24 @@ public:
     // Given denomination and id returns latest accumulator value and corresponding block hash
     // Do not take into account coins with height more than maxHeight
     // Returns number of coins satisfying conditions
+    // Takes cs_main, the view stays valid after it is released, whatever happens to the state
     int GetCoinSetForSpend(
         CChain *chain,
         int maxHeight,
         sigma::CoinDenomination denomination,
         int id,
         uint256& blockHash_out,
-        std::vector<sigma::PublicCoin>& coins_out);
+        sigma::AnonymitySetView& coins_out);
+
+    // Anonymity set of the coin group ending at the block with given hash, or at the first block of the
+    // group if there is no such block in it. Sets setBlock_out to the block the set ends at.
+    // Takes cs_main, so that a block check can use it without holding cs_main. The view stays valid after
+    // it is released, whatever happens to the state
+    sigma::AnonymitySetView GetAnonymitySet(
+        sigma::CoinDenomination denomination,
+        int id,
+        const uint256& blockHash,
+        CBlockIndex **setBlock_out = NULL);
 
     // Return height of mint transaction and id of minted coin
     std::pair<int, int> GetMintedCoinHeightAndId(const sigma::PublicCoin& pubCoin);
@@ -176,6 +311,21 @@ public:
     // Reset to initial values
     void Reset();
 
+    // Move the coins of the groups no mint can go to anymore to their group files
+    void SealGroups();
+
+    // Group file of a sealed coin group, NULL if the group isn't sealed
+    std::shared_ptr<const CSigmaGroupFile> GetSealedGroup(sigma::CoinDenomination denomination, int id) const;
+
+    // Seal groups and write the state to the privacy index so that the next start doesn't have to replay the
+    // whole chain. Only the serials and coin groups changed since the previous snapshot are written. Writes
+    // nothing if the state isn't the one at chainTip. Returns false if the write failed
+    bool WriteSnapshot(const CBlockIndex *chainTip);
+
+    // Replace the state by the snapshot in the privacy index. Returns the block of the snapshot, or NULL
+    // and leaves the state reset if there is no snapshot of a block of chain
+    CBlockIndex *ReadSnapshot(CChain *chain);
+
     // Check if there is a conflicting tx in the blockchain or mempool
     bool CanAddSpendToMempool(const Scalar& coinSerial);
 
@@ -217,22 +367,54 @@ private:
     // Collection of coin groups. Map from <denomination,id> to CoinGroupInfo structure
     std::unordered_map<pair<sigma::CoinDenomination, int>, CoinGroupInfo, pairhash> coinGroups;
 
+    // Coins of every coin group. Map from <denomination,id> to CoinGroupCoins structure
+    std::unordered_map<pair<sigma::CoinDenomination, int>, CoinGroupCoins, pairhash> coinGroupCoins;
+
+    // Guards mintedPubCoins, mintedPubCoinHashes, usedCoinSerials and usedCoinSerialHashes. They are changed
+    // under cs_main and this lock held exclusively, so code holding cs_main may read them without it.
+    // Taken after cs_mempoolConflicts
+    mutable boost::shared_mutex cs_coins;
+
     // Set of all minted pubCoin values, keyed by the public coin.
     // Used for checking if the given coin already exists.
     unordered_map<sigma::PublicCoin, CMintedCoinInfo, sigma::CPublicCoinHash> mintedPubCoins;
 
+    // Values of minted coins keyed by GetPubCoinValueHash(), one entry per entry of mintedPubCoins.
+    // Used for the wallet lookups by hash.
+    std::unordered_multimap<uint256, GroupElement, sigma::CUint256Hash> mintedPubCoinHashes;
+
     // Latest IDs of coins by denomination
     std::unordered_map<sigma::CoinDenomination, int> latestCoinIds;
 
     // Set of all used coin serials.
     std::unordered_set<Scalar, sigma::CScalarHash> usedCoinSerials;
 
+    // Used coin serials keyed by GetSerialHash()
+    std::unordered_map<uint256, Scalar, sigma::CUint256Hash> usedCoinSerialHashes;
+
+    // Guards mempoolCoinSerials and mempoolCoinMints
+    mutable boost::shared_mutex cs_mempoolConflicts;
+
     // serials of spends currently in the mempool mapped to tx hashes
     std::unordered_map<Scalar, uint256, sigma::CScalarHash> mempoolCoinSerials;
 
     // values of mints currently in the mempool mapped to tx hashes
     unordered_map<sigma::PublicCoin,uint256, sigma::CPublicCoinHash> mempoolCoinMints;
 
+    // Last block added to the state. Only meaningful while fTipKnown, which stays set as long as blocks
+    // are added and removed in chain order since the last reset
+    CBlockIndex *tip;
+    bool fTipKnown;
+
+    // Serials spent (true) or no longer spent (false) and coin groups changed since the last snapshot written or
+    // read. If fSnapshotStale the records in the privacy index don't match the state and all are written again
+    std::unordered_map<Scalar, bool, sigma::CScalarHash> changedSerials;
+    std::set<std::pair<sigma::CoinDenomination, int>> changedGroups;
+    bool fSnapshotStale;
+
+    // Add minted coin and used serial to the lookups, cs_coins must be held exclusively
+    void InsertMintedCoin(const sigma::PublicCoin& pubCoin, const CMintedCoinInfo& coinInfo);
+    void InsertUsedCoinSerial(const Scalar& serial);
 };
 
 bool IsSigmaAllowed();
@@ -0,0 +1,201 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <zerocoin/sigmagroupfile.h>
+
+#include <clientversion.h>
+#include <crypto/sha256.h>
+#include <streams.h>
+#include <tinyformat.h>
+#include <util.h>
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using secp_primitives::GroupElement;
+
+// The coins are used where they lie in the file
+static_assert(std::is_trivially_copyable<GroupElement>::value && std::is_trivially_destructible<GroupElement>::value,
+    "GroupElement can't be used in place in a mapped file");
+
+static const char SIGMA_GROUP_FILE_MAGIC[4] = {'S', 'G', 'R', 'P'};
+static const uint32_t SIGMA_GROUP_FILE_VERSION = 1;
+// The coins follow the header at this offset, which keeps them aligned
+static const std::size_t SIGMA_GROUP_FILE_HEADER_SIZE = 128;
+
+static_assert(SIGMA_GROUP_FILE_HEADER_SIZE % alignof(GroupElement) == 0, "Coins of a group file are misaligned");
+
+fs::path GetSigmaGroupFilePath(int nDenomination, int nId)
+{
+    return GetDataDir() / "sigma" / strprintf("group-%d-%d.dat", nDenomination, nId);
+}
+
+CSigmaGroupFile::CSigmaGroupFile() : pbegin(nullptr), nFileSize(0), values(nullptr), nValues(0)
+{
+}
+
+CSigmaGroupFile::~CSigmaGroupFile()
+{
+#ifndef WIN32
+    if (pbegin && buffer.empty())
+        munmap(const_cast<unsigned char*>(pbegin), nFileSize);
+#endif
+}
+
+std::shared_ptr<const CSigmaGroupFile> CSigmaGroupFile::Create(const fs::path& path, const GroupElement* valuesIn, std::size_t nValuesIn)
+{
+    if (nValuesIn == 0)
+        return nullptr;
+
+    std::vector<GroupElement> normalized(valuesIn, valuesIn + nValuesIn);
+    GroupElement::normalize_all(normalized);
+
+    // set() copies only the point, the rest of the storage of every coin stays zero
+    std::vector<unsigned char> data(nValuesIn * sizeof(GroupElement), 0);
+    GroupElement* stored = reinterpret_cast<GroupElement*>(data.data());
+    for (std::size_t i = 0; i < nValuesIn; i++)
+        (new (&stored[i]) GroupElement())->set(normalized[i]);
+
+    uint256 checksum;
+    CSHA256().Write(data.data(), data.size()).Finalize(checksum.begin());
+
+    // The first and the last coin in serialized form tell whether a build reading the file lays out
+    // GroupElement the same way
+    unsigned char first[GroupElement::serialize_size], last[GroupElement::serialize_size];
+    stored[0].serialize(first);
+    stored[nValuesIn - 1].serialize(last);
+
+    CDataStream header(SER_DISK, CLIENT_VERSION);
+    header.write(SIGMA_GROUP_FILE_MAGIC, sizeof(SIGMA_GROUP_FILE_MAGIC));
+    header << SIGMA_GROUP_FILE_VERSION << (uint32_t)sizeof(GroupElement) << (uint64_t)nValuesIn;
+    header.write((const char*)first, sizeof(first));
+    header.write((const char*)last, sizeof(last));
+    header << checksum;
+    assert(header.size() <= SIGMA_GROUP_FILE_HEADER_SIZE);
+    header.resize(SIGMA_GROUP_FILE_HEADER_SIZE, 0);
+
+    // Written aside and renamed over, a file that is mapped stays as it is
+    fs::path pathTmp = path;
+    pathTmp += ".new";
+    TryCreateDirectories(path.parent_path());
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file)
+        return nullptr;
+    bool fWritten = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+        fwrite(data.data(), 1, data.size(), file) == data.size();
+    if (fWritten)
+        FileCommit(file);
+    fclose(file);
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        LogPrintf("%s: failed to write %s\n", __func__, path.string());
+        boost::system::error_code ec;
+        fs::remove(pathTmp, ec);
+        return nullptr;
+    }
+
+    return Map(path);
+}
+
+std::shared_ptr<const CSigmaGroupFile> CSigmaGroupFile::Open(const fs::path& path, const uint256& checksum)
+{
+    std::shared_ptr<const CSigmaGroupFile> file = Map(path);
+    if (file && file->GetChecksum() != checksum)
+        return nullptr;
+    return file;
+}
+
+std::shared_ptr<const CSigmaGroupFile> CSigmaGroupFile::Map(const fs::path& path)
+{
+    std::shared_ptr<CSigmaGroupFile> file(new CSigmaGroupFile());
+
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < SIGMA_GROUP_FILE_HEADER_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+    file->pbegin = static_cast<const unsigned char*>(mapping);
+    file->nFileSize = st.st_size;
+#else
+    // No mapping here, the file is read into memory
+    FILE* f = fsbridge::fopen(path, "rb");
+    if (!f)
+        return nullptr;
+    fseek(f, 0, SEEK_END);
+    long nSize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (nSize < (long)SIGMA_GROUP_FILE_HEADER_SIZE) {
+        fclose(f);
+        return nullptr;
+    }
+    file->buffer.resize(nSize);
+    bool fRead = fread(file->buffer.data(), 1, nSize, f) == (size_t)nSize;
+    fclose(f);
+    if (!fRead)
+        return nullptr;
+    file->pbegin = file->buffer.data();
+    file->nFileSize = nSize;
+#endif
+
+    char magic[sizeof(SIGMA_GROUP_FILE_MAGIC)];
+    uint32_t nVersion, nElementSize;
+    uint64_t nValues;
+    unsigned char first[GroupElement::serialize_size], last[GroupElement::serialize_size];
+    try {
+        CDataStream header((const char*)file->pbegin, (const char*)file->pbegin + SIGMA_GROUP_FILE_HEADER_SIZE, SER_DISK, CLIENT_VERSION);
+        header.read(magic, sizeof(magic));
+        header >> nVersion >> nElementSize >> nValues;
+        header.read((char*)first, sizeof(first));
+        header.read((char*)last, sizeof(last));
+        header >> file->checksum;
+    } catch (const std::ios_base::failure&) {
+        return nullptr;
+    }
+
+    if (memcmp(magic, SIGMA_GROUP_FILE_MAGIC, sizeof(magic)) != 0 || nVersion != SIGMA_GROUP_FILE_VERSION ||
+            nElementSize != sizeof(GroupElement) || nValues == 0 ||
+            nValues != (file->nFileSize - SIGMA_GROUP_FILE_HEADER_SIZE) / sizeof(GroupElement) ||
+            (file->nFileSize - SIGMA_GROUP_FILE_HEADER_SIZE) % sizeof(GroupElement) != 0) {
+        LogPrintf("%s: %s is not a valid group file\n", __func__, path.string());
+        return nullptr;
+    }
+
+    const unsigned char* pdata = file->pbegin + SIGMA_GROUP_FILE_HEADER_SIZE;
+    uint256 checksum;
+    CSHA256().Write(pdata, nValues * sizeof(GroupElement)).Finalize(checksum.begin());
+    if (checksum != file->checksum) {
+        LogPrintf("%s: %s is corrupt\n", __func__, path.string());
+        return nullptr;
+    }
+
+    file->values = reinterpret_cast<const GroupElement*>(pdata);
+    file->nValues = nValues;
+
+    unsigned char serialized[GroupElement::serialize_size];
+    file->values[0].serialize(serialized);
+    bool fLayoutMatches = memcmp(serialized, first, sizeof(serialized)) == 0;
+    file->values[nValues - 1].serialize(serialized);
+    fLayoutMatches = fLayoutMatches && memcmp(serialized, last, sizeof(serialized)) == 0;
+    if (!fLayoutMatches) {
+        LogPrintf("%s: %s was written with another GroupElement layout\n", __func__, path.string());
+        return nullptr;
+    }
+
+    return file;
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The NIX Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef NIX_SIGMAGROUPFILE_H
+#define NIX_SIGMAGROUPFILE_H
+
+#include <fs.h>
+#include <uint256.h>
+#include <secp256k1/include/GroupElement.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Coins of a sealed Sigma coin group, one that no mint can go to anymore, in a file of <datadir>/sigma/.
+ * The coins are stored as normalized GroupElements in the storage order of sigma::AnonymitySetView and the
+ * file is mapped read-only, so the prover and the verifiers use them in place, without parsing them and
+ * without keeping them on the heap.
+ */
+class CSigmaGroupFile
+{
+public:
+    ~CSigmaGroupFile();
+
+    CSigmaGroupFile(const CSigmaGroupFile&) = delete;
+    CSigmaGroupFile& operator=(const CSigmaGroupFile&) = delete;
+
+    //! Write the coins to the file at path, replacing it, and map it. NULL if that fails
+    static std::shared_ptr<const CSigmaGroupFile> Create(const fs::path& path, const secp_primitives::GroupElement* values, std::size_t nValues);
+
+    //! Map the file at path if it holds the coins with the given checksum. NULL if it is missing or corrupt,
+    //! holds other coins or was written by a build with another GroupElement layout
+    static std::shared_ptr<const CSigmaGroupFile> Open(const fs::path& path, const uint256& checksum);
+
+    const secp_primitives::GroupElement* data() const { return values; }
+    std::size_t size() const { return nValues; }
+
+    //! SHA256 of the coins as stored in the file
+    const uint256& GetChecksum() const { return checksum; }
+
+private:
+    //! The whole file, mapped or read into buffer where mapping isn't supported
+    const unsigned char* pbegin;
+    std::size_t nFileSize;
+    std::vector<unsigned char> buffer;
+
+    const secp_primitives::GroupElement* values;
+    std::size_t nValues;
+    uint256 checksum;
+
+    CSigmaGroupFile();
+
+    static std::shared_ptr<const CSigmaGroupFile> Map(const fs::path& path);
+};
+
+//! Path of the file of coin group nId of the given denomination
+fs::path GetSigmaGroupFilePath(int nDenomination, int nId);
+
+#endif // NIX_SIGMAGROUPFILE_H
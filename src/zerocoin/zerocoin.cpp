@@ -11,6 +11,9 @@
 #include <net_processing.h>
 #include "utilstrencodings.h"
 #include "consensus/airdropaddresses.h"
+#include "txdb.h"
+#include "parallel.h"
+#include "ui_interface.h"
 
 using namespace std;
 using namespace boost;
@@ -24,6 +27,16 @@ libzerocoin::Params *ZCParams = new libzerocoin::Params(bnTrustedModulus, bnTrus
 
 static CZerocoinState zerocoinState;
 
+// Checkpoints of a cached witness kept besides the one of the mint block, enough for the spends a few blocks
+// below the tip and for short reorganizations
+static const size_t ZEROCOIN_WITNESS_CHECKPOINTS = 10;
+
+static std::atomic<uint64_t> nSkippedZerocoinProofs(0);
+
+uint64_t GetSkippedZerocoinProofCount() {
+    return nSkippedZerocoinProofs;
+}
+
 static bool CheckZerocoinSpendSerial(CValidationState &state, CZerocoinTxInfo *zerocoinTxInfo, libzerocoin::CoinDenomination denomination, const CBigNum &serial, int nHeight, bool fConnectTip) {
     // check for zerocoin transaction in this block as well
     if (zerocoinTxInfo && !zerocoinTxInfo->fInfoIsComplete && zerocoinTxInfo->spentSerials.count(serial) > 0)
@@ -159,23 +172,31 @@ bool CheckSpendZerocoinTransaction(const CTransaction &tx,
             index = index->pprev;
     }
 
+    if (zerocoinTxInfo && zerocoinTxInfo->fAssumeValidProofs) {
+        // The proof was verified by the chain the anchor block commits to, serial and group are still checked
+        passVerify = true;
+        zerocoinTxInfo->nSkippedProofs++;
+    }
+
     // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
     // In most cases the latest accumulator value will be used for verification
-    do {
-        if (index->accumulatorChanges.count(denominationAndId) > 0) {
+    while (!passVerify) {
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(index);
+        auto accChange = blockData->accumulatorChanges.find(denominationAndId);
+        if (accChange != blockData->accumulatorChanges.end()) {
             libzerocoin::Accumulator accumulator(ZCParams,
-                                                 index->accumulatorChanges[denominationAndId].first,
+                                                 accChange->second.first,
                                                  targetDenomination);
             //LogPrintf("CheckSpendZerocoinTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
             passVerify = newSpend.Verify(accumulator, newMetadata);
 
         }
 
-        if (index == coinGroup.firstBlock || spendHasBlockHash)
+        if (passVerify || index == coinGroup.firstBlock || spendHasBlockHash)
             break;
         else
             index = index->pprev;
-    } while (!passVerify);
+    }
 
     if (passVerify) {
 
@@ -438,23 +459,30 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
 }
 
 void DisconnectTipGhost(CBlock & /*block*/, CBlockIndex *pindexDelete) {
-    zerocoinState.RemoveBlock(pindexDelete);
+    zerocoinState.RemoveBlock(pindexDelete, *pprivacyindex->ReadBlockData(pindexDelete));
 }
 
 
 /**
  * Connect a new ZCblock to chainActive. pblock is either NULL or a pointer to a CBlock
- * corresponding to pindexNew, to bypass loading it again from disk.
+ * corresponding to pindexNew, to bypass loading it again from disk. privacyData holds the
+ * privacy index data of pindexNew, its zerocoin part is rebuilt from pblock. Skipped spend proofs
+ * are counted only when the block isn't just checked.
  */
-bool ConnectBlockGhost(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock) {
+bool ConnectBlockGhost(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock, CBlockPrivacyData &privacyData, bool fJustCheck) {
 
     // Add zerocoin transaction information to index
     if (pblock && pblock->zerocoinTxInfo) {
 
-        pindexNew->spentSerials.clear();
+        if (!fJustCheck)
+            nSkippedZerocoinProofs += pblock->zerocoinTxInfo->nSkippedProofs;
+
+        privacyData.spentSerials.clear();
+        privacyData.mintedPubCoins.clear();
+        privacyData.accumulatorChanges.clear();
 
         BOOST_FOREACH(const PAIRTYPE(CBigNum,int) &serial, pblock->zerocoinTxInfo->spentSerials) {
-            pindexNew->spentSerials.insert(serial.first);
+            privacyData.spentSerials.insert(serial.first);
             if (!CheckZerocoinSpendSerial(state, pblock->zerocoinTxInfo.get(), (libzerocoin::CoinDenomination)serial.second, serial.first, pindexNew->nHeight, true))
                 return false;
             zerocoinState.AddSpend(serial.first);
@@ -469,29 +497,34 @@ bool ConnectBlockGhost(CValidationState &state, const CChainParams &chainparams,
             //LogPrintf("ConnectTipZC: mint added denomination=%d, id=%d\n", denomination, mintId);
             pair<int,int> denomAndId = make_pair(denomination, mintId);
 
-            pindexNew->mintedPubCoins[denomAndId].push_back(mint.second);
+            privacyData.mintedPubCoins[denomAndId].push_back(mint.second);
 
             CZerocoinState::CoinGroupInfo coinGroupInfo;
             zerocoinState.GetCoinGroupInfo(denomination, mintId, coinGroupInfo);
 
+            // Earlier mints of this block in the same group are not in the privacy index yet
+            auto blockAccChange = privacyData.accumulatorChanges.find(denomAndId);
+            if (blockAccChange != privacyData.accumulatorChanges.end())
+                oldAccValue = blockAccChange->second.first;
+
             libzerocoin::PublicCoin pubCoin(ZCParams, mint.second, (libzerocoin::CoinDenomination)denomination);
             libzerocoin::Accumulator accumulator(ZCParams,
                                                  oldAccValue,
                                                  (libzerocoin::CoinDenomination)denomination);
             accumulator += pubCoin;
 
-            if (pindexNew->accumulatorChanges.count(denomAndId) > 0) {
-                pair<CBigNum,int> &accChange = pindexNew->accumulatorChanges[denomAndId];
+            if (blockAccChange != privacyData.accumulatorChanges.end()) {
+                pair<CBigNum,int> &accChange = blockAccChange->second;
                 accChange.first = accumulator.getValue();
                 accChange.second++;
             }
             else {
-                pindexNew->accumulatorChanges[denomAndId] = make_pair(accumulator.getValue(), 1);
+                privacyData.accumulatorChanges[denomAndId] = make_pair(accumulator.getValue(), 1);
             }
         }
     }
     else {
-        zerocoinState.AddBlock(pindexNew);
+        zerocoinState.AddBlock(pindexNew, privacyData);
     }
 
     // TODO: notify the wallet
@@ -514,7 +547,7 @@ bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes) {
 
     zerocoinState.Reset();
     for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
-        zerocoinState.AddBlock(blockIndex);
+        zerocoinState.AddBlock(blockIndex, *pprivacyindex->ReadBlockData(blockIndex));
 
     changes = zerocoinState.RecalculateAccumulators(chain);
     // DEBUG
@@ -581,7 +614,12 @@ int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum
             coinGroup.firstBlock = coinGroup.lastBlock = index;
         }
         else {
-            previousAccValue = coinGroup.lastBlock->accumulatorChanges[make_pair(denomination,mintId)].first;
+            // The caller knows the accumulator of earlier mints of index itself
+            if (coinGroup.lastBlock != index) {
+                std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(coinGroup.lastBlock);
+                auto accChange = blockData->accumulatorChanges.find(make_pair(denomination, mintId));
+                previousAccValue = accChange != blockData->accumulatorChanges.end() ? accChange->second.first : CBigNum();
+            }
             coinGroup.lastBlock = index;
         }
     }
@@ -605,8 +643,8 @@ void CZerocoinState::AddSpend(const CBigNum &serial) {
     usedCoinSerials.insert(serial);
 }
 
-void CZerocoinState::AddBlock(CBlockIndex *index) {
-    for(const pair<pair<int,int>, pair<CBigNum,int>> &accUpdate: index->accumulatorChanges)
+void CZerocoinState::AddBlock(CBlockIndex *index, const CBlockPrivacyData &blockData) {
+    for(const pair<pair<int,int>, pair<CBigNum,int>> &accUpdate: blockData.accumulatorChanges)
     {
         CoinGroupInfo   &coinGroup = coinGroups[accUpdate.first];
 
@@ -616,7 +654,7 @@ void CZerocoinState::AddBlock(CBlockIndex *index) {
         coinGroup.nCoins += accUpdate.second.second;
     }
 
-    for(const pair<pair<int,int>,vector<CBigNum>> &pubCoins: index->mintedPubCoins) {
+    for(const pair<pair<int,int>,vector<CBigNum>> &pubCoins: blockData.mintedPubCoins) {
         latestCoinIds[pubCoins.first.first] = pubCoins.first.second;
         BOOST_FOREACH(const CBigNum &coin, pubCoins.second) {
             CMintedCoinInfo coinInfo;
@@ -626,15 +664,15 @@ void CZerocoinState::AddBlock(CBlockIndex *index) {
             mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(coin, coinInfo));
         }
     }
-    BOOST_FOREACH(const CBigNum &serial, index->spentSerials) {
+    BOOST_FOREACH(const CBigNum &serial, blockData.spentSerials) {
         usedCoinSerials.insert(serial);
     }
 
 }
 
-void CZerocoinState::RemoveBlock(CBlockIndex *index) {
+void CZerocoinState::RemoveBlock(CBlockIndex *index, const CBlockPrivacyData &blockData) {
     // roll back accumulator updates
-    for(const pair<pair<int,int>, pair<CBigNum,int>> &accUpdate: index->accumulatorChanges)
+    for(const pair<pair<int,int>, pair<CBigNum,int>> &accUpdate: blockData.accumulatorChanges)
     {
         CoinGroupInfo   &coinGroup = coinGroups[accUpdate.first];
         int  nMintsToForget = accUpdate.second.second;
@@ -652,12 +690,12 @@ void CZerocoinState::RemoveBlock(CBlockIndex *index) {
             do {
                 assert(coinGroup.lastBlock != coinGroup.firstBlock);
                 coinGroup.lastBlock = coinGroup.lastBlock->pprev;
-            } while (coinGroup.lastBlock->accumulatorChanges.count(accUpdate.first) == 0);
+            } while (pprivacyindex->ReadBlockData(coinGroup.lastBlock)->accumulatorChanges.count(accUpdate.first) == 0);
         }
     }
 
     // roll back mints
-    for(const pair<pair<int,int>,vector<CBigNum>> &pubCoins: index->mintedPubCoins) {
+    for(const pair<pair<int,int>,vector<CBigNum>> &pubCoins: blockData.mintedPubCoins) {
         BOOST_FOREACH(const CBigNum &coin, pubCoins.second) {
             auto coins = mintedPubCoins.equal_range(coin);
             auto coinIt = find_if(coins.first, coins.second, [=](const decltype(mintedPubCoins)::value_type &v) {
@@ -670,9 +708,61 @@ void CZerocoinState::RemoveBlock(CBlockIndex *index) {
     }
 
     // roll back spends
-    BOOST_FOREACH(const CBigNum &serial, index->spentSerials) {
+    BOOST_FOREACH(const CBigNum &serial, blockData.spentSerials) {
         usedCoinSerials.erase(serial);
     }
+
+    // roll back cached witnesses
+    for (auto it = coinWitnesses.begin(); it != coinWitnesses.end(); ) {
+        CZerocoinWitnessRecord &record = it->second;
+        bool fChanged = false;
+        while (!record.checkpoints.empty() && record.checkpoints.rbegin()->first >= index->nHeight) {
+            record.checkpoints.erase(std::prev(record.checkpoints.end()));
+            fChanged = true;
+        }
+        if (record.checkpoints.empty()) {
+            // the coin isn't in the chain anymore
+            pprivacyindex->EraseZerocoinWitness(it->first);
+            it = coinWitnesses.erase(it);
+            continue;
+        }
+        if (record.hashTip == index->GetBlockHash()) {
+            // Only the newest remaining checkpoint is known to be complete, checkpoints between it and index->pprev
+            // may have been pruned. The next request catches up from there
+            record.hashTip = record.checkpoints.rbegin()->second.first;
+            fChanged = true;
+        }
+        if (fChanged)
+            WriteCoinWitness(it->first, record);
+        ++it;
+    }
+}
+
+void CZerocoinState::UpdateCoinWitnesses(CBlockIndex *index, const CBlockPrivacyData &blockData) {
+    // blocks that are only checked, e.g. block templates, have no hash and are never written
+    if (index->pprev == NULL || index->phashBlock == NULL)
+        return;
+
+    const uint256 hashPrev = index->pprev->GetBlockHash();
+    for (auto &coinWitness: coinWitnesses) {
+        CZerocoinWitnessRecord &record = coinWitness.second;
+        // A witness that missed blocks is brought up to date when it is asked for
+        if (record.hashTip != hashPrev || record.checkpoints.empty())
+            continue;
+        record.hashTip = index->GetBlockHash();
+
+        const pair<int, int> &denomAndId = coinWitness.first.first;
+        auto pubCoins = blockData.mintedPubCoins.find(denomAndId);
+        if (pubCoins == blockData.mintedPubCoins.end())
+            continue;
+
+        libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomAndId.first;
+        libzerocoin::Accumulator accumulator(ZCParams, record.checkpoints.rbegin()->second.second, d);
+        for (const CBigNum &coin: pubCoins->second)
+            accumulator += libzerocoin::PublicCoin(ZCParams, coin, d);
+        record.checkpoints[index->nHeight] = make_pair(index->GetBlockHash(), accumulator.getValue());
+        WriteCoinWitness(coinWitness.first, record);
+    }
 }
 
 bool CZerocoinState::GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result) {
@@ -701,25 +791,22 @@ int CZerocoinState::GetAccumulatorValueForSpend(CChain *chain, int maxHeight, in
     CoinGroupInfo coinGroup = coinGroups[denomAndId];
     CBlockIndex *lastBlock = coinGroup.lastBlock;
 
-    assert(lastBlock->accumulatorChanges.count(denomAndId) > 0);
-    assert(coinGroup.firstBlock->accumulatorChanges.count(denomAndId) > 0);
-
-    // field in the block index structure for accesing accumulator changes
-    decltype(&CBlockIndex::accumulatorChanges) accChangeField;
-    accChangeField = &CBlockIndex::accumulatorChanges;
+    assert(pprivacyindex->ReadBlockData(lastBlock)->accumulatorChanges.count(denomAndId) > 0);
+    assert(pprivacyindex->ReadBlockData(coinGroup.firstBlock)->accumulatorChanges.count(denomAndId) > 0);
 
     int numberOfCoins = 0;
     for (;;) {
-        map<pair<int,int>, pair<CBigNum,int>> &accumulatorChanges = lastBlock->*accChangeField;
-        if (accumulatorChanges.count(denomAndId) > 0) {
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(lastBlock);
+        auto accChange = blockData->accumulatorChanges.find(denomAndId);
+        if (accChange != blockData->accumulatorChanges.end()) {
             if (lastBlock->nHeight <= maxHeight) {
                 if (numberOfCoins == 0) {
                     // latest block satisfying given conditions
                     // remember accumulator value and block hash
-                    accumulator = accumulatorChanges[denomAndId].first;
+                    accumulator = accChange->second.first;
                     blockHash = lastBlock->GetBlockHash();
                 }
-                numberOfCoins += accumulatorChanges[denomAndId].second;
+                numberOfCoins += accChange->second.second;
             }
         }
         if (lastBlock == coinGroup.firstBlock)
@@ -731,46 +818,131 @@ int CZerocoinState::GetAccumulatorValueForSpend(CChain *chain, int maxHeight, in
     return numberOfCoins;
 }
 
-libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin) {
-    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
-    pair<int, int> denomAndId = pair<int, int>(denomination, id);
+CBigNum CZerocoinState::GetAccumulatorBeforeBlock(CBlockIndex *block, const pair<int, int> &denomAndId) {
+    if (block == coinGroups[denomAndId].firstBlock)
+        return ZCParams->accumulatorParams.accumulatorBase;
 
-    assert(coinGroups.count(denomAndId) > 0);
+    std::shared_ptr<const CBlockPrivacyData> blockData;
+    do {
+        block = block->pprev;
+        blockData = pprivacyindex->ReadBlockData(block);
+    } while (blockData->accumulatorChanges.count(denomAndId) == 0);
+    return blockData->accumulatorChanges.at(denomAndId).first;
+}
 
-    CoinGroupInfo coinGroup = coinGroups[denomAndId];
+void CZerocoinState::AddGroupMints(CChain *chain, const pair<int, int> &denomAndId, int nFromHeight, int nToHeight, libzerocoin::Accumulator &accumulator) {
+    // nothing was minted to the group after its last block
+    nToHeight = std::min(nToHeight, coinGroups[denomAndId].lastBlock->nHeight);
+    for (int nHeight = nFromHeight + 1; nHeight <= nToHeight; nHeight++) {
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData((*chain)[nHeight]);
+        auto pubCoins = blockData->mintedPubCoins.find(denomAndId);
+        if (pubCoins == blockData->mintedPubCoins.end())
+            continue;
+        for (const CBigNum &coin: pubCoins->second)
+            accumulator += libzerocoin::PublicCoin(ZCParams, coin, accumulator.getDenomination());
+    }
+}
 
-    int coinId;
-    int mintHeight = GetMintedCoinHeightAndId(pubCoin, denomination, coinId);
+void CZerocoinState::WriteCoinWitness(const CZerocoinWitnessKey &key, CZerocoinWitnessRecord &record) {
+    // the checkpoint of the mint block stays, it is where the witness is rebuilt from after a deep reorganization
+    while (record.checkpoints.size() > ZEROCOIN_WITNESS_CHECKPOINTS + 1)
+        record.checkpoints.erase(std::next(record.checkpoints.begin()));
 
-    assert(coinId == id);
+    if (!pprivacyindex->WriteZerocoinWitness(key, record))
+        LogPrintf("ZerocoinState: failed to write the witness of a coin of denomination=%d, id=%d\n", key.first.first, key.first.second);
+}
+
+CBigNum CZerocoinState::GetCoinWitness(CChain *chain, int maxHeight, const CZerocoinWitnessKey &key) {
+    const pair<int, int> &denomAndId = key.first;
+    int mintHeight = key.second.first;
+    const CBigNum &pubCoin = key.second.second;
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomAndId.first;
+
+    assert(coinGroups.count(denomAndId) > 0);
 
-    // Find accumulator value preceding mint operation
     CBlockIndex *mintBlock = (*chain)[mintHeight];
-    CBlockIndex *block = mintBlock;
-    libzerocoin::Accumulator accumulator(ZCParams, d);
-    if (block != coinGroup.firstBlock) {
-        do {
-            block = block->pprev;
-        } while (block->accumulatorChanges.count(denomAndId) == 0);
-        accumulator = libzerocoin::Accumulator(ZCParams, block->accumulatorChanges[denomAndId].first, d);
+    if (maxHeight < mintHeight)
+        return GetAccumulatorBeforeBlock(mintBlock, denomAndId);
+    maxHeight = std::min(maxHeight, chain->Height());
+
+    auto it = coinWitnesses.find(key);
+    if (it == coinWitnesses.end()) {
+        CZerocoinWitnessRecord record;
+        if (!pprivacyindex->ReadZerocoinWitness(key, record))
+            record = CZerocoinWitnessRecord();
+        it = coinWitnesses.insert(make_pair(key, record)).first;
+    }
+    CZerocoinWitnessRecord &record = it->second;
+    bool fChanged = false;
+
+    // checkpoints of blocks that left the chain are of no use
+    for (auto checkpoint = record.checkpoints.begin(); checkpoint != record.checkpoints.end(); ) {
+        if (checkpoint->first > chain->Height() || (*chain)[checkpoint->first]->GetBlockHash() != checkpoint->second.first) {
+            checkpoint = record.checkpoints.erase(checkpoint);
+            fChanged = true;
+        }
+        else
+            ++checkpoint;
     }
 
-    // Now add to the accumulator every coin minted since that moment except pubCoin
-    block = coinGroup.lastBlock;
-    while(true) {
-        if (block->nHeight <= maxHeight && block->mintedPubCoins.count(denomAndId) > 0) {
-            vector<CBigNum> &pubCoins = block->mintedPubCoins[denomAndId];
-            for (const CBigNum &coin: pubCoins) {
-                if (block != mintBlock || coin != pubCoin)
+    if (record.checkpoints.count(mintHeight) == 0) {
+        // Accumulator preceding the mint operation and the other coins minted in the same block
+        libzerocoin::Accumulator accumulator(ZCParams, GetAccumulatorBeforeBlock(mintBlock, denomAndId), d);
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(mintBlock);
+        auto pubCoins = blockData->mintedPubCoins.find(denomAndId);
+        if (pubCoin != 0 && pubCoins != blockData->mintedPubCoins.end()) {
+            for (const CBigNum &coin: pubCoins->second) {
+                if (coin != pubCoin)
                     accumulator += libzerocoin::PublicCoin(ZCParams, coin, d);
             }
         }
-        if (block != mintBlock)
-            block = block->pprev;
-        else
-            break;
+        record.checkpoints[mintHeight] = make_pair(mintBlock->GetBlockHash(), accumulator.getValue());
+        if (record.checkpoints.size() == 1)
+            record.hashTip = mintBlock->GetBlockHash();
+        fChanged = true;
+    }
+
+    // Start from the newest checkpoint up to maxHeight and add every coin minted since
+    auto checkpoint = std::prev(record.checkpoints.upper_bound(maxHeight));
+    libzerocoin::Accumulator accumulator(ZCParams, checkpoint->second.second, d);
+    AddGroupMints(chain, denomAndId, checkpoint->first, maxHeight, accumulator);
+    CBigNum witness = accumulator.getValue();
+    if (witness != checkpoint->second.second) {
+        record.checkpoints[maxHeight] = make_pair((*chain)[maxHeight]->GetBlockHash(), witness);
+        fChanged = true;
+    }
+
+    // Bring the newest checkpoint up to the tip, the blocks connected from now on extend it
+    if (record.hashTip != chain->Tip()->GetBlockHash()) {
+        auto newest = std::prev(record.checkpoints.end());
+        libzerocoin::Accumulator latest(ZCParams, newest->second.second, d);
+        AddGroupMints(chain, denomAndId, newest->first, chain->Height(), latest);
+        if (latest.getValue() != newest->second.second)
+            record.checkpoints[chain->Height()] = make_pair(chain->Tip()->GetBlockHash(), latest.getValue());
+        record.hashTip = chain->Tip()->GetBlockHash();
+        fChanged = true;
     }
 
+    if (fChanged)
+        WriteCoinWitness(key, record);
+    return witness;
+}
+
+libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin) {
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
+    pair<int, int> denomAndId = pair<int, int>(denomination, id);
+
+    assert(coinGroups.count(denomAndId) > 0);
+
+    int coinId;
+    int mintHeight = GetMintedCoinHeightAndId(pubCoin, denomination, coinId);
+
+    assert(coinId == id);
+
+    // Accumulator of every coin of the group minted up to maxHeight except pubCoin
+    CBigNum witness = GetCoinWitness(chain, maxHeight, make_pair(denomAndId, make_pair(mintHeight, pubCoin)));
+    libzerocoin::Accumulator accumulator(ZCParams, witness, d);
+
     return libzerocoin::AccumulatorWitness(ZCParams, accumulator, libzerocoin::PublicCoin(ZCParams, pubCoin, d));
 }
 
@@ -814,7 +986,9 @@ bool CZerocoinState::GetWitnessForAllSpends(std::vector<CBigNum> &accValues, std
 
             CoinGroupInfo coinGroup = coinGroups[denomAndId];
             CBlockIndex *lastBlock = coinGroup.lastBlock;
-            accValues.push_back(lastBlock->accumulatorChanges[make_pair(denomValue,mintId)].first);
+            std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(lastBlock);
+            auto accChange = blockData->accumulatorChanges.find(denomAndId);
+            accValues.push_back(accChange != blockData->accumulatorChanges.end() ? accChange->second.first : CBigNum());
             accBlockHashes.push_back(lastBlock->GetBlockHash());
         }
     }
@@ -834,42 +1008,12 @@ bool CZerocoinState::GetWitnessForAllSpends(std::vector<CBigNum> &accValues, std
 }
 
 CBigNum CZerocoinState::GetWitnessForHeight(int denomination, int mintHeight, int maxHeight) {
-    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
     pair<int, int> denomAndId = pair<int, int>(denomination, 1);
 
     assert(coinGroups.count(denomAndId) > 0);
 
-    CoinGroupInfo coinGroup = coinGroups[denomAndId];
-
-
-    // Find accumulator value preceding mint operation
-    CBlockIndex *mintBlock = chainActive[mintHeight];
-    CBlockIndex *block = mintBlock;
-    libzerocoin::Accumulator accumulator(ZCParams, d);
-    if (block != coinGroup.firstBlock) {
-        do {
-            block = block->pprev;
-        } while (block->accumulatorChanges.count(denomAndId) == 0);
-        accumulator = libzerocoin::Accumulator(ZCParams, block->accumulatorChanges[denomAndId].first, d);
-    }
-
-    // Now add to the accumulator every coin minted since that moment except pubCoin
-    block = coinGroup.lastBlock;
-    while(true) {
-        if (block->nHeight <= maxHeight && block->mintedPubCoins.count(denomAndId) > 0) {
-            vector<CBigNum> &pubCoins = block->mintedPubCoins[denomAndId];
-            for (const CBigNum &coin: pubCoins) {
-                if (block != mintBlock)
-                    accumulator += libzerocoin::PublicCoin(ZCParams, coin, d);
-            }
-        }
-        if (block != mintBlock)
-            block = block->pprev;
-        else
-            break;
-    }
-
-    return accumulator.getValue();
+    // Every coin minted after the block at mintHeight up to maxHeight, none of that block
+    return GetCoinWitness(&chainActive, maxHeight, make_pair(denomAndId, make_pair(mintHeight, CBigNum(0))));
 }
 
 bool ZerocoinUpgradeBlockIndex(CChain *chain) {
@@ -929,22 +1073,25 @@ bool CZerocoinState::TestValidity(CChain *chain) {
 
         CBlockIndex *block = coinGroup.second.firstBlock;
         for (;;) {
-            if (block->accumulatorChanges.count(coinGroup.first) > 0) {
-                if (block->mintedPubCoins.count(coinGroup.first) == 0) {
+            std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(block);
+            if (blockData->accumulatorChanges.count(coinGroup.first) > 0) {
+                if (blockData->mintedPubCoins.count(coinGroup.first) == 0) {
                     fprintf(stderr, "  no minted coins\n");
                     return false;
                 }
 
-                BOOST_FOREACH(const CBigNum &pubCoin, block->mintedPubCoins[coinGroup.first]) {
+                const vector<CBigNum> &pubCoins = blockData->mintedPubCoins.at(coinGroup.first);
+                const pair<CBigNum,int> &accChange = blockData->accumulatorChanges.at(coinGroup.first);
+                BOOST_FOREACH(const CBigNum &pubCoin, pubCoins) {
                     acc += libzerocoin::PublicCoin(zcParams, pubCoin, (libzerocoin::CoinDenomination)coinGroup.first.first);
                 }
 
-                if (acc.getValue() != block->accumulatorChanges[coinGroup.first].first) {
+                if (acc.getValue() != accChange.first) {
                     fprintf (stderr, "  accumulator value mismatch at height %d\n", block->nHeight);
                     return false;
                 }
 
-                if (block->accumulatorChanges[coinGroup.first].second != (int)block->mintedPubCoins[coinGroup.first].size()) {
+                if (accChange.second != (int)pubCoins.size()) {
                     fprintf(stderr, "  number of minted coins mismatch at height %d\n", block->nHeight);
                     return false;
                 }
@@ -962,41 +1109,96 @@ bool CZerocoinState::TestValidity(CChain *chain) {
     return true;
 }
 
-set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
-    set<CBlockIndex *> changes;
-
-    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CoinGroupInfo) &coinGroup, coinGroups) {
-
-        libzerocoin::Accumulator acc(&ZCParams->accumulatorParams, (libzerocoin::CoinDenomination)coinGroup.first.first);
+namespace {
+
+// New accumulator value and number of coins of a group at a block
+struct CAccumulatorChange {
+    CBlockIndex *block;
+    pair<int, int> denomAndId;
+    CBigNum value;
+    int nPubCoins;
+};
+
+// acc^c1^c2...^ck is the same as acc^(c1*c2*...*ck), one exponentiation for all the coins of a block
+CBigNum AccumulateBlockCoins(const CBigNum &value, const vector<CBigNum> &pubCoins) {
+    CBigNum product = 1;
+    BOOST_FOREACH(const CBigNum &pubCoin, pubCoins) {
+        product = product * pubCoin;
+    }
+    return value.pow_mod(product, ZCParams->accumulatorParams.accumulatorModulus);
+}
 
-        // Try to calculate accumulator for the first batch of mints. If it doesn't match we need to recalculate the rest of it
-        CBlockIndex *block = coinGroup.second.firstBlock;
-        for (;;) {
-            if (block->accumulatorChanges.count(coinGroup.first) > 0) {
-                BOOST_FOREACH(const CBigNum &pubCoin, block->mintedPubCoins[coinGroup.first]) {
-                    acc += libzerocoin::PublicCoin(ZCParams, pubCoin, (libzerocoin::CoinDenomination)coinGroup.first.first);
-                }
+void RecalculateGroupAccumulators(CChain *chain, const pair<int, int> &denomAndId, const CZerocoinState::CoinGroupInfo &coinGroup,
+                                  vector<CAccumulatorChange> &changes) {
+    CBigNum value = ZCParams->accumulatorParams.accumulatorBase;
 
-                // First block case is special: do the check
-                if (block == coinGroup.second.firstBlock) {
-                    if (acc.getValue() != block->accumulatorChanges[coinGroup.first].first)
-                        // recalculation is needed
-                        LogPrintf("ZerocoinState: accumulator recalculation for denomination=%d, id=%d\n", coinGroup.first.first, coinGroup.first.second);
-                    else
-                        // everything's ok
-                        break;
-                }
+    // Try to calculate accumulator for the first batch of mints. If it doesn't match we need to recalculate the rest of it
+    CBlockIndex *block = coinGroup.firstBlock;
+    for (;;) {
+        std::shared_ptr<const CBlockPrivacyData> blockData = pprivacyindex->ReadBlockData(block);
+        if (blockData->accumulatorChanges.count(denomAndId) > 0) {
+            auto pubCoins = blockData->mintedPubCoins.find(denomAndId);
+            int nPubCoins = 0;
+            if (pubCoins != blockData->mintedPubCoins.end()) {
+                value = AccumulateBlockCoins(value, pubCoins->second);
+                nPubCoins = pubCoins->second.size();
+            }
 
-                block->accumulatorChanges[coinGroup.first] = make_pair(acc.getValue(), (int)block->mintedPubCoins[coinGroup.first].size());
-                changes.insert(block);
+            // First block case is special: do the check
+            if (block == coinGroup.firstBlock) {
+                if (value != blockData->accumulatorChanges.at(denomAndId).first)
+                    // recalculation is needed
+                    LogPrintf("ZerocoinState: accumulator recalculation for denomination=%d, id=%d\n", denomAndId.first, denomAndId.second);
+                else
+                    // everything's ok
+                    break;
             }
 
-            if (block != coinGroup.second.lastBlock)
-                block = (*chain)[block->nHeight+1];
-            else
-                break;
+            changes.push_back({block, denomAndId, value, nPubCoins});
         }
+
+        if (block != coinGroup.lastBlock)
+            block = (*chain)[block->nHeight+1];
+        else
+            break;
+    }
+}
+
+} // namespace
+
+set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
+    set<CBlockIndex *> changes;
+
+    // Coin groups don't depend on each other and are recalculated in parallel. A block can change the accumulators
+    // of several groups, the new values are written block by block once all the groups are done
+    vector<pair<pair<int, int>, CoinGroupInfo>> groups(coinGroups.begin(), coinGroups.end());
+    vector<vector<CAccumulatorChange>> groupChanges(groups.size());
+
+    const std::string strTitle = _("Recalculating Zerocoin accumulators...");
+    std::atomic<size_t> nGroupsDone(0);
+    uiInterface.ShowProgress(strTitle, 0, false);
+    ParallelFor(groups.size(), 1, [&](size_t i) {
+        RecalculateGroupAccumulators(chain, groups[i].first, groups[i].second, groupChanges[i]);
+        uiInterface.ShowProgress(strTitle, std::min(99, (int)(++nGroupsDone * 100 / groups.size())), false);
+    });
+
+    vector<CAccumulatorChange> allChanges;
+    for (vector<CAccumulatorChange> &group: groupChanges)
+        allChanges.insert(allChanges.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
+    std::stable_sort(allChanges.begin(), allChanges.end(), [](const CAccumulatorChange &a, const CAccumulatorChange &b) {
+        return a.block->nHeight < b.block->nHeight;
+    });
+
+    for (size_t i = 0; i < allChanges.size(); ) {
+        CBlockIndex *block = allChanges[i].block;
+        CBlockPrivacyData newBlockData(*pprivacyindex->ReadBlockData(block));
+        for (; i < allChanges.size() && allChanges[i].block == block; i++)
+            newBlockData.accumulatorChanges[allChanges[i].denomAndId] = make_pair(allChanges[i].value, allChanges[i].nPubCoins);
+        if (!pprivacyindex->WriteBlockData(block, newBlockData))
+            LogPrintf("ZerocoinState: failed to write accumulator at height %d\n", block->nHeight);
+        changes.insert(block);
     }
+    uiInterface.ShowProgress("", 100, false);
 
     return changes;
 }
@@ -1049,6 +1251,7 @@ bool CZerocoinState::CanAddMintToMempool(const CBigNum &coinMint) {
 
 void CZerocoinState::Reset() {
     coinGroups.clear();
+    coinWitnesses.clear();
     usedCoinSerials.clear();
     mintedPubCoins.clear();
     latestCoinIds.clear();
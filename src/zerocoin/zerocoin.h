@@ -31,8 +31,12 @@ public:
     map<CBigNum, int> spentSerials;
     // information about transactions in the block is complete
     bool fInfoIsComplete;
+    // the block is buried under -assumevalidprivacy, spend proofs aren't verified
+    bool fAssumeValidProofs;
+    // spend proofs not verified because of fAssumeValidProofs
+    int nSkippedProofs;
 
-    CZerocoinTxInfo(): fInfoIsComplete(false) {}
+    CZerocoinTxInfo(): fInfoIsComplete(false), fAssumeValidProofs(false), nSkippedProofs(0) {}
     // finalize everything
     void Complete();
 };
@@ -46,8 +50,11 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
     bool isCheckWallet,
     CZerocoinTxInfo *zerocoinTxInfo);
 
+// Number of Zerocoin spend proofs of connected blocks not verified because they are buried under -assumevalidprivacy
+uint64_t GetSkippedZerocoinProofCount();
+
 void DisconnectTipGhost(CBlock &block, CBlockIndex *pindexDelete);
-bool ConnectBlockGhost(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock);
+bool ConnectBlockGhost(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock, CBlockPrivacyData &privacyData, bool fJustCheck = false);
 
 int ZerocoinGetNHeight(const CBlockHeader &block);
 
@@ -91,6 +98,18 @@ private:
     unordered_multimap<CBigNum,CMintedCoinInfo,CBigNumHash> mintedPubCoins;
     // Latest IDs of coins by denomination
     map<int, int> latestCoinIds;
+    // Witnesses of the coins asked for so far, loaded from and written to the privacy index. Kept up to date as
+    // blocks connect, so the witness of a coin is built once and extended by the coins minted after it
+    map<CZerocoinWitnessKey, CZerocoinWitnessRecord> coinWitnesses;
+
+    // Accumulator of the coins of the group minted before block
+    CBigNum GetAccumulatorBeforeBlock(CBlockIndex *block, const pair<int, int> &denomAndId);
+    // Add the coins of the group minted in the blocks of heights (nFromHeight, nToHeight] to accumulator
+    void AddGroupMints(CChain *chain, const pair<int, int> &denomAndId, int nFromHeight, int nToHeight, libzerocoin::Accumulator &accumulator);
+    // Witness of a coin with every other coin of its group minted up to maxHeight. A zero public coin stands
+    // for a witness without any of the coins minted at the mint height
+    CBigNum GetCoinWitness(CChain *chain, int maxHeight, const CZerocoinWitnessKey &key);
+    void WriteCoinWitness(const CZerocoinWitnessKey &key, CZerocoinWitnessRecord &record);
 
 public:
     CZerocoinState();
@@ -109,9 +128,11 @@ public:
     void AddSpend(const CBigNum &serial);
 
     // Add everything from the block to the state
-    void AddBlock(CBlockIndex *index);
+    void AddBlock(CBlockIndex *index, const CBlockPrivacyData &blockData);
     // Disconnect block from the chain rolling back mints and spends
-    void RemoveBlock(CBlockIndex *index);
+    void RemoveBlock(CBlockIndex *index, const CBlockPrivacyData &blockData);
+    // Add the coins minted in the block to the cached witnesses
+    void UpdateCoinWitnesses(CBlockIndex *index, const CBlockPrivacyData &blockData);
 
     // Query coin group with given denomination and id
     bool GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result);